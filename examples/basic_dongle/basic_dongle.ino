@@ -125,6 +125,7 @@ void loop() {
 
     // once paired, check for data, and print it
     // immediately with some extra info
+    // (printing is slow, the stream_dongle example keeps up with far more)
     if (!dongle.has_data()) {
         return;
     }
@@ -0,0 +1,96 @@
+// Example script for a dongle receiving two kinds of messages from a host
+// over one link: frequent samples and a rare status report.
+// the host is built with the same NRFMessage<Sample, Status> as its TData,
+// and sends either type with send(), e.g. host.send(sample)
+
+// for dongle
+#define NRF_DONGLE
+
+// if dongle is nrf52, otherwise if it is an nrf24 define NRF24
+#define NRF52
+
+#include "nrf_dongle.h"
+
+#ifdef NRF52
+    #include "nrf_to_nrf.h"
+
+    nrf_to_nrf radio;
+
+    uint8_t data_rate = NRF_2MBPS;
+    uint8_t power_level = NRF_PA_HIGH;
+#endif // NRF52
+
+#ifdef NRF24
+    #include <RF24.h>
+
+    RF24 radio(9, 10); // CE, CSN
+
+    uint8_t data_rate = RF24_2MBPS;
+    uint8_t power_level = RF24_PA_HIGH;
+#endif // NRF24
+
+uint64_t program_id = 0; // program id must match between host and dongle
+
+uint32_t pair_timeout_millis = 120000; // 2 minutes
+uint16_t ping_interval_millis = 1000; // 1 second
+uint8_t retry_delay = 5; // delay is (x + 1) * 250us, default is 1.5ms
+uint8_t retry_count = 15; // 15 retries
+
+// the message types, the host must list them in the same order
+struct Sample {
+    int16_t x;
+    int16_t y;
+    int16_t z;
+};
+
+struct Status {
+    uint32_t uptime_millis;
+    uint8_t battery_percent;
+};
+
+typedef NRFMessage<Sample, Status> Message;
+
+// a packet of samples carries 6 bytes per sample, not the size of a Status
+NRFDongle<Message, 16> dongle(radio, 0, program_id, ping_interval_millis, pair_timeout_millis, data_rate, power_level, retry_delay, retry_count);
+
+// one handler per type
+NRFHandlers<Sample, Status> handlers;
+
+void on_sample(const Sample &sample, uint8_t host, void *context) {
+    Serial.print("[DONGLE] Sample ");
+    Serial.print(sample.x);
+    Serial.print(" ");
+    Serial.print(sample.y);
+    Serial.print(" ");
+    Serial.println(sample.z);
+}
+
+void on_status(const Status &status, uint8_t host, void *context) {
+    Serial.print("[DONGLE] Status: up ");
+    Serial.print(status.uptime_millis);
+    Serial.print(" ms, battery ");
+    Serial.print(status.battery_percent);
+    Serial.println("%");
+}
+
+void setup() {
+    Serial.begin(115200);
+
+    // start the radio
+    dongle.begin();
+
+    handlers.on<Sample>(on_sample);
+    handlers.on<Status>(on_status);
+}
+
+void loop() {
+    // update the radio
+    dongle.update();
+
+    // hand every message received to the handler for its type
+    Message message;
+    uint8_t host;
+    while (dongle.read(message, host)) {
+        handlers.dispatch(message, host);
+    }
+}
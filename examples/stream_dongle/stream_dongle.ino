@@ -0,0 +1,66 @@
+// Example script for a dongle streaming the data it receives to a PC
+// as binary records, which keeps up with far more data than printing
+// every value as text (see basic_dongle). decode the stream on the PC
+// with extras/stream, e.g. ./nrf_stream --size 4 /dev/ttyACM0
+
+// for dongle
+#define NRF_DONGLE
+
+// if dongle is nrf52, otherwise if it is an nrf24 define NRF24
+#define NRF52
+
+// bytes of records gathered before they are written to Serial at once
+#define NRF_SINK_BUFFER 512
+
+#include "nrf_dongle.h"
+
+#ifdef NRF52
+    #include "nrf_to_nrf.h"
+
+    nrf_to_nrf radio;
+
+    uint8_t data_rate = NRF_2MBPS;
+    uint8_t power_level = NRF_PA_HIGH;
+#endif // NRF52
+
+#ifdef NRF24
+    #include <RF24.h>
+
+    RF24 radio(9, 10); // CE, CSN
+
+    uint8_t data_rate = RF24_2MBPS;
+    uint8_t power_level = RF24_PA_HIGH;
+#endif // NRF24
+
+uint64_t program_id = 0; // program id must match between host and dongle
+
+uint32_t pair_timeout_millis = 120000; // 2 minutes
+uint16_t ping_interval_millis = 1000; // 1 second
+uint8_t retry_delay = 5; // delay is (x + 1) * 250us, default is 1.5ms
+uint8_t retry_count = 15; // 15 retries
+
+// the data is a float, with a buffer of 32 elements,
+// as the sink only empties it once per loop
+NRFDongle<float, 32> dongle(radio, 0, program_id, ping_interval_millis, pair_timeout_millis, data_rate, power_level, retry_delay, retry_count);
+
+// the sink takes everything the dongle receives, from every host,
+// and writes it to Serial, one record (micros, host, float, CRC) per value
+NRFSerialSink<NRFBackend, float, 32> sink(dongle, Serial);
+
+void setup() {
+    // the baud rate only matters for a real UART, USB serial ignores it
+    Serial.begin(921600);
+
+    // start the radio
+    dongle.begin();
+
+    // write records at least every 5 ms, even when few arrive
+    sink.set_flush_interval(5);
+}
+
+void loop() {
+    // update the radio, then hand what it received to the sink,
+    // nothing else may read from the dongle
+    dongle.update();
+    sink.update();
+}
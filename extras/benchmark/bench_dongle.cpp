@@ -0,0 +1,120 @@
+// dongle end of the benchmark link
+// bench_multi_dongle.cpp builds it again for several hosts,
+// bench_irq_dongle.cpp for receiving from the radio's interrupt
+
+#define NRF_DONGLE
+#define NRF_SIM
+#ifndef NRF_DONGLE_NAMESPACE
+    #define NRF_DONGLE_NAMESPACE bench_dongle
+    #define BENCH_MAKE_DONGLE make_dongle
+#endif
+
+#include <algorithm>
+
+#include "../../nrf_dongle.h"
+#include "bench_link.h"
+
+namespace {
+
+template <size_t N, uint8_t M> class DongleEndpoint : public Endpoint {
+    public:
+        DongleEndpoint(SimRadio &radio, const LinkSettings &s) :
+            radio(radio),
+            link(radio, 0, s.program_id, 0, 0, s.data_rate, s.power_level, s.retry_delay, s.retry_count) {
+            this->link.set_overflow_policy(s.overflow_policy);
+            this->link.set_duty_cycle(s.wake_interval_millis > 0);
+        }
+
+        #ifdef NRF_IRQ
+            ~DongleEndpoint() { this->radio.detachInterrupt(); }
+
+            void begin() {
+                this->link.begin();
+                this->radio.attachInterrupt(irq, this);
+            }
+
+            static void irq(void *context) {
+                ((DongleEndpoint *)context)->link.irq();
+            }
+        #else
+            void begin() { this->link.begin(); }
+        #endif // NRF_IRQ
+        void update() { this->link.update(); }
+        bool is_paired() { return this->link.is_paired(); }
+
+        bool send(uint32_t seq) {
+            typename ReplyOf<N>::type sample;
+            memset(&sample, 0, sizeof(sample));
+            memcpy(sample.bytes, &seq, sizeof(seq));
+            return this->link.send(sample);
+        }
+
+        bool read(uint32_t &seq) {
+            Sample<N> sample;
+            if (!this->link.read(sample)) {
+                return false;
+            }
+            memcpy(&seq, sample.bytes, sizeof(seq));
+            return true;
+        }
+
+        uint8_t high_water_mark() {
+            uint8_t mark = 0;
+            for (uint8_t host = 0; host < NRF_MAX_HOSTS; host++) {
+                mark = std::max(mark, this->link.get_high_water_mark(host));
+            }
+            return mark;
+        }
+
+        uint8_t data_rate() { return this->link.get_data_rate(); }
+        uint8_t channel() { return this->link.get_channel(); }
+        bool asleep() { return this->link.get_sleep_millis() > 0; }
+
+        // oldest first, in place in each host's buffer
+        size_t read_batch(uint32_t *seq, size_t n) {
+            size_t count = 0;
+            for (uint8_t host = 0; host < NRF_MAX_HOSTS; host++) {
+                const Sample<N> *samples;
+                size_t run;
+                while (count < n && (run = this->link.peek(samples, host)) > 0) {
+                    if (run > n - count) {
+                        run = n - count;
+                    }
+                    for (size_t i = 0; i < run; i++) {
+                        memcpy(&seq[count + i], samples[i].bytes, sizeof(uint32_t));
+                    }
+                    this->link.consume(run, host);
+                    count += run;
+                }
+            }
+            return count;
+        }
+
+    private:
+        SimRadio &radio;
+        NRF_DONGLE_NAMESPACE::NRFDongle<Sample<N>, M, typename ReplyOf<N>::type> link;
+};
+
+template <size_t N> Endpoint *make_sized(SimRadio &radio, const LinkSettings &settings, size_t max_packets) {
+    switch (max_packets) {
+        case 4: return new DongleEndpoint<N, 4>(radio, settings);
+        case 16: return new DongleEndpoint<N, 16>(radio, settings);
+        case 64: return new DongleEndpoint<N, 64>(radio, settings);
+        default: return nullptr;
+    }
+}
+
+} // namespace
+
+Endpoint *BENCH_MAKE_DONGLE(SimRadio &radio, const LinkSettings &settings, size_t data_size, size_t max_packets) {
+    switch (data_size) {
+        case 4: return make_sized<4>(radio, settings, max_packets);
+        case 8: return make_sized<8>(radio, settings, max_packets);
+        case 16: return make_sized<16>(radio, settings, max_packets);
+        case 28: return make_sized<28>(radio, settings, max_packets);
+        case 31: return make_sized<31>(radio, settings, max_packets);
+        case 64: return make_sized<64>(radio, settings, max_packets);
+        case 256: return make_sized<256>(radio, settings, max_packets);
+        default: return nullptr;
+    }
+}
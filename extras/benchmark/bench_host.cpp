@@ -0,0 +1,85 @@
+// host end of the benchmark link
+// bench_reliable_host.cpp builds it again numbering its packets
+
+#define NRF_HOST
+#define NRF_SIM
+#ifndef NRF_DONGLE_NAMESPACE
+    #define NRF_DONGLE_NAMESPACE bench_host
+    #define BENCH_MAKE_HOST make_host
+#endif
+
+#include "../../nrf_dongle.h"
+#include "bench_link.h"
+
+namespace {
+
+template <size_t N, uint8_t M> class HostEndpoint : public Endpoint {
+    public:
+        HostEndpoint(SimRadio &radio, const LinkSettings &s) :
+            link(radio, s.unique_id, s.program_id, s.ping_interval_millis, 0, s.data_rate, s.power_level, s.retry_delay, s.retry_count) {
+            this->link.set_burst_budget(s.burst_budget_micros);
+            this->link.set_max_items_per_packet(s.max_items_per_packet);
+            this->link.set_overflow_policy(s.overflow_policy);
+            this->link.set_adaptive(s.adaptive);
+            this->link.set_migration_threshold(s.migration_threshold);
+            this->link.set_reconnect_grace(s.reconnect_grace_millis);
+            this->link.set_update_budget(s.update_budget_micros);
+            this->link.set_delta(s.delta_keyframes);
+            this->link.set_max_ping_interval(s.max_ping_interval_millis);
+            this->link.set_wake_interval(s.wake_interval_millis);
+            #ifdef NRF_PACKET_SEQUENCE
+                this->link.set_reliable(true);
+            #endif // NRF_PACKET_SEQUENCE
+        }
+
+        void begin() { this->link.begin(); }
+        void update() { this->link.update(); }
+        bool is_paired() { return this->link.is_paired(); }
+
+        bool send(uint32_t seq) {
+            Sample<N> sample;
+            memset(&sample, 0, sizeof(sample));
+            memcpy(sample.bytes, &seq, sizeof(seq));
+            return this->link.send(sample);
+        }
+
+        bool read(uint32_t &seq) {
+            typename ReplyOf<N>::type sample;
+            if (!this->link.read(sample)) {
+                return false;
+            }
+            memcpy(&seq, sample.bytes, sizeof(seq));
+            return true;
+        }
+
+        uint8_t high_water_mark() { return this->link.get_high_water_mark(); }
+        uint8_t data_rate() { return this->link.get_data_rate(); }
+        uint8_t channel() { return this->link.get_channel(); }
+
+    private:
+        NRF_DONGLE_NAMESPACE::NRFDongle<Sample<N>, M, typename ReplyOf<N>::type> link;
+};
+
+template <size_t N> Endpoint *make_sized(SimRadio &radio, const LinkSettings &settings, size_t max_packets) {
+    switch (max_packets) {
+        case 4: return new HostEndpoint<N, 4>(radio, settings);
+        case 16: return new HostEndpoint<N, 16>(radio, settings);
+        case 64: return new HostEndpoint<N, 64>(radio, settings);
+        default: return nullptr;
+    }
+}
+
+} // namespace
+
+Endpoint *BENCH_MAKE_HOST(SimRadio &radio, const LinkSettings &settings, size_t data_size, size_t max_packets) {
+    switch (data_size) {
+        case 4: return make_sized<4>(radio, settings, max_packets);
+        case 8: return make_sized<8>(radio, settings, max_packets);
+        case 16: return make_sized<16>(radio, settings, max_packets);
+        case 28: return make_sized<28>(radio, settings, max_packets);
+        case 31: return make_sized<31>(radio, settings, max_packets);
+        case 64: return make_sized<64>(radio, settings, max_packets);
+        case 256: return make_sized<256>(radio, settings, max_packets);
+        default: return nullptr;
+    }
+}
@@ -0,0 +1,7 @@
+// dongle end of the benchmark link, receiving from the radio's interrupt
+
+#define NRF_IRQ
+#define NRF_DONGLE_NAMESPACE bench_irq_dongle
+#define BENCH_MAKE_DONGLE make_irq_dongle
+
+#include "bench_dongle.cpp"
@@ -0,0 +1,142 @@
+#ifndef BENCH_LINK_H
+#define BENCH_LINK_H
+
+// Interface between the benchmark driver and the two ends of the link.
+// The host and the dongle are compiled in separate translation units
+// (bench_host.cpp, bench_dongle.cpp), so that each variant can be built
+// with its own flags (e.g. NRF_PACKET_SEQUENCE, NRF_IRQ) next to the others.
+
+#include <stddef.h>
+#include <stdint.h>
+
+class SimRadio;
+
+// the NRFDongle constructor settings being swept
+struct LinkSettings {
+    uint64_t unique_id;
+    uint64_t program_id;
+    uint16_t ping_interval_millis;
+    uint8_t data_rate;
+    uint8_t power_level;
+    uint8_t retry_delay;
+    uint8_t retry_count;
+    // host only, 0 sends one packet per update()
+    uint16_t burst_budget_micros;
+    // host only, 0 packs as many items per packet as fit
+    uint8_t max_items_per_packet;
+    // what full buffers do with new items, one of the _QUEUE_ constants
+    uint8_t overflow_policy;
+    // host only, adapt the data rate, PA level and retries to the air
+    bool adaptive;
+    // host only, loss percent that moves the link to another channel, 0 never
+    uint8_t migration_threshold;
+    // host only, how long a lost dongle is looked for before pairing again
+    uint16_t reconnect_grace_millis;
+    // host only, 0 blocks in update() until each packet is done,
+    // otherwise the non-blocking mode with this much time per update()
+    uint16_t update_budget_micros;
+    // items sent as deltas with a full packet every delta_keyframes,
+    // 0 for none
+    uint8_t delta_keyframes;
+    // host only, how far apart pings grow, 0 keeps ping_interval_millis
+    uint16_t max_ping_interval_millis;
+    // the host's wake interval, the dongle duty cycles its radio if not 0
+    uint16_t wake_interval_millis;
+};
+
+// one end of the link, TData is a Sample<data_size> whose
+// first 4 bytes carry a sequence number
+class Endpoint {
+    public:
+        virtual ~Endpoint() {}
+        virtual void begin() = 0;
+        virtual void update() = 0;
+        virtual bool is_paired() = 0;
+
+        // queue the sample with sequence number seq,
+        // on the dongle it is a reply riding back on the ACKs
+        virtual bool send(uint32_t seq) = 0;
+
+        // pop one sample and return its sequence number,
+        // on the host it is a reply from the dongle
+        virtual bool read(uint32_t &seq) = 0;
+
+        // most items buffered at once, the host's send queue
+        // or the dongle's fullest host buffer
+        virtual uint8_t high_water_mark() = 0;
+
+        // data rate in use, it moves on an adaptive link
+        virtual uint8_t data_rate() = 0;
+
+        // data channel in use
+        virtual uint8_t channel() = 0;
+
+        // the dongle's radio is powered down between wake windows
+        virtual bool asleep() {
+            return false;
+        }
+
+        // read up to n samples at once, returns how many were read
+        virtual size_t read_batch(uint32_t *seq, size_t n) {
+            size_t count = 0;
+            while (count < n && this->read(seq[count])) {
+                count++;
+            }
+            return count;
+        }
+};
+
+// sizes and capacities the benchmark is instantiated for
+// the last three are sent in fragments, 31 bytes only just: it would fit
+// behind a one byte header, but fragments are sized for a sequence byte,
+// so a numbering host (--reliable) and a plain dongle agree on it
+static const size_t bench_data_sizes[] = {4, 8, 16, 28, 31, 64, 256};
+static const size_t bench_max_packets[] = {4, 16, 64};
+
+// return nullptr if data_size or max_packets is not instantiated
+Endpoint *make_host(SimRadio &radio, const LinkSettings &settings, size_t data_size, size_t max_packets);
+Endpoint *make_dongle(SimRadio &radio, const LinkSettings &settings, size_t data_size, size_t max_packets);
+
+// host built with NRF_PACKET_SEQUENCE and set_reliable(true)
+Endpoint *make_reliable_host(SimRadio &radio, const LinkSettings &settings, size_t data_size, size_t max_packets);
+
+// dongle built with NRF_MAX_HOSTS = bench_max_hosts, replies go to host 0
+static const uint8_t bench_max_hosts = 5;
+Endpoint *make_multi_dongle(SimRadio &radio, const LinkSettings &settings, size_t data_size, size_t max_packets);
+
+// dongle built with NRF_IRQ, receiving from the radio's interrupt
+Endpoint *make_irq_dongle(SimRadio &radio, const LinkSettings &settings, size_t data_size, size_t max_packets);
+
+// a repeater between the hosts and the dongle (--repeater): a dongle to the
+// hosts on one radio and a host to the dongle on another, pairing with
+// program_id + 1, with both roles built in bench_repeater.cpp
+class Relay {
+    public:
+        virtual ~Relay() {}
+        virtual void begin() = 0;
+        virtual void update() = 0;
+        virtual bool is_paired() = 0;
+
+        // items forwarded to the downstream hop, and of them those lost and
+        // delivered there, and the average time from forwarding an item
+        // to its packet being acknowledged there
+        virtual uint64_t hop_forwarded() = 0;
+        virtual uint64_t hop_lost() = 0;
+        virtual uint64_t hop_delivered() = 0;
+        virtual uint32_t hop_avg_micros() = 0;
+};
+
+Relay *make_repeater(SimRadio &upstream, SimRadio &downstream, const LinkSettings &settings, size_t data_size, size_t max_packets);
+
+// fixed size payload, the first 4 bytes are the sequence number
+template <size_t N> struct Sample {
+    uint8_t bytes[N];
+};
+
+// replies ride on the ACKs, which cannot be fragmented,
+// so the large samples are answered with small ones
+template <size_t N> struct ReplyOf {
+    typedef Sample<(N > 28 ? 4 : N)> type;
+};
+
+#endif // BENCH_LINK_H
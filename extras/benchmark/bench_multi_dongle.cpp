@@ -0,0 +1,9 @@
+// dongle end of the benchmark link, serving up to bench_max_hosts hosts
+
+#define NRF_MAX_HOSTS 5
+#define NRF_DONGLE_NAMESPACE bench_multi_dongle
+#define BENCH_MAKE_DONGLE make_multi_dongle
+
+#include "bench_dongle.cpp"
+
+static_assert(NRF_MAX_HOSTS == bench_max_hosts, "bench_max_hosts must match NRF_MAX_HOSTS");
@@ -0,0 +1,7 @@
+// host end of the benchmark link, resending until every packet is acknowledged
+
+#define NRF_PACKET_SEQUENCE
+#define NRF_DONGLE_NAMESPACE bench_reliable_host
+#define BENCH_MAKE_HOST make_reliable_host
+
+#include "bench_host.cpp"
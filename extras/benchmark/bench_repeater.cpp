@@ -0,0 +1,67 @@
+// repeater between the hosts and the dongle of the benchmark link,
+// both of its links built here, in one translation unit, with NRFLink
+
+#define NRF_SIM
+#define NRF_STATS
+#define NRF_MAX_HOSTS 5
+#define NRF_DONGLE_NAMESPACE bench_repeater
+
+#include "../../nrf_dongle.h"
+#include "bench_link.h"
+
+namespace {
+
+template <size_t N, uint8_t M> class RepeaterRelay : public Relay {
+    public:
+        typedef NRF_DONGLE_NAMESPACE::NRFRepeater<NRF_DONGLE_NAMESPACE::NRFSimBackend, NRF_DONGLE_NAMESPACE::NRFSimBackend, Sample<N>, M, typename ReplyOf<N>::type> Repeater;
+
+        RepeaterRelay(SimRadio &upstream_radio, SimRadio &downstream_radio, const LinkSettings &s) :
+            upstream(upstream_radio, 0, s.program_id, 0, 0, s.data_rate, s.power_level, s.retry_delay, s.retry_count),
+            downstream(downstream_radio, s.unique_id + 0x100, s.program_id + 1, s.ping_interval_millis, 0, s.data_rate, s.power_level, s.retry_delay, s.retry_count),
+            repeater(upstream, downstream) {
+            this->upstream.set_overflow_policy(s.overflow_policy);
+            this->downstream.set_max_items_per_packet(s.max_items_per_packet);
+            this->downstream.set_reconnect_grace(s.reconnect_grace_millis);
+            // non-blocking, so the upstream hop keeps moving while
+            // a packet is in flight downstream
+            this->downstream.set_update_budget(s.update_budget_micros > 0 ? s.update_budget_micros : 200);
+        }
+
+        void begin() { this->repeater.begin(); }
+        void update() { this->repeater.update(); }
+        bool is_paired() { return this->repeater.is_paired(); }
+
+        uint64_t hop_forwarded() { return this->repeater.get_stats().forwarded; }
+        uint64_t hop_lost() { return this->repeater.get_stats().lost; }
+        uint64_t hop_delivered() { return this->repeater.get_stats().delivered; }
+        uint32_t hop_avg_micros() { return this->repeater.get_stats().hop_avg_micros; }
+
+    private:
+        typename Repeater::Upstream upstream;
+        typename Repeater::Downstream downstream;
+        Repeater repeater;
+};
+
+template <size_t N> Relay *make_sized(SimRadio &upstream, SimRadio &downstream, const LinkSettings &settings, size_t max_packets) {
+    switch (max_packets) {
+        case 4: return new RepeaterRelay<N, 4>(upstream, downstream, settings);
+        case 16: return new RepeaterRelay<N, 16>(upstream, downstream, settings);
+        case 64: return new RepeaterRelay<N, 64>(upstream, downstream, settings);
+        default: return nullptr;
+    }
+}
+
+} // namespace
+
+Relay *make_repeater(SimRadio &upstream, SimRadio &downstream, const LinkSettings &settings, size_t data_size, size_t max_packets) {
+    switch (data_size) {
+        case 4: return make_sized<4>(upstream, downstream, settings, max_packets);
+        case 8: return make_sized<8>(upstream, downstream, settings, max_packets);
+        case 16: return make_sized<16>(upstream, downstream, settings, max_packets);
+        case 28: return make_sized<28>(upstream, downstream, settings, max_packets);
+        case 31: return make_sized<31>(upstream, downstream, settings, max_packets);
+        case 64: return make_sized<64>(upstream, downstream, settings, max_packets);
+        case 256: return make_sized<256>(upstream, downstream, settings, max_packets);
+        default: return nullptr;
+    }
+}
@@ -0,0 +1,966 @@
+// Link benchmark for NRFDongle on the simulated radio (nrf_sim.h)
+//
+// drives a host and a dongle through send() / update() / read()
+// on the virtual clock (or several hosts sending to one dongle, --hosts),
+// sweeping the radio settings, the ping interval,
+// the host's burst budget, items per packet, max_packets and the size of TData,
+// and reports per configuration:
+//     delivered items per second, from all hosts, and their bytes per second
+//     (the 31, 64 and 256 byte samples are sent in fragments)
+//     p50 / p99 / max latency from send() on the host to read() on the dongle
+//     lost items (accepted by send() but never read)
+//     dropped items (refused by send(), see --policy)
+//     high-water marks of the host's send queue and the dongle's buffer,
+//     to size max_packets from
+//     the data rate and channel the link ended on (--adaptive and
+//     --migrate move them, --noise puts interference on a band of channels)
+//     delivered replies per second and their p50 latency, dongle to host
+//     virtual time spent inside a host's update() (how long it blocks the loop)
+//     real cpu time per update() call (to catch regressions in update() itself)
+//     real cpu time per item read on the dongle (--batch reads in place)
+//     the share of time the dongle's radio was listening (--wake lets it
+//     sleep between the hosts' wake windows)
+//     with --repeater, the items lost on the repeater's downstream hop and
+//     the average time from forwarding an item to its ACK there, and the
+//     items the dongle actually missed there, to check the first against
+//     (run with --ack-loss 0 --burst-enter 0 for them to be equal)
+//
+// or, with --pairing N, how long hosts that boot together take to pair
+// (p50 / p90 / p99 / max) as their number grows to N, with as many dongles
+// as they need, and the frames lost to collisions on the way
+//
+// or, with --cross-talk, whether two dongles whose hosts' unique_ids differ
+// only in the low byte keep apart, checking every item each dongle reads
+// comes from one host, and exiting with 1 if not
+//
+// build (from this directory):
+//     g++ -std=c++11 -O2 -pthread -o benchmark benchmark.cpp bench_host.cpp bench_dongle.cpp bench_multi_dongle.cpp bench_irq_dongle.cpp bench_reliable_host.cpp bench_repeater.cpp
+// run:
+//     ./benchmark            full sweep, aligned table
+//     ./benchmark --csv      full sweep, csv
+//     ./benchmark --quick    a few configurations only
+//     ./benchmark --pairing 20
+//     ./benchmark --cross-talk
+//     ./benchmark --help     all options
+//
+// every run is reproducible: the loss model is seeded (--seed)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "../../nrf_sim.h"
+#include "bench_link.h"
+
+namespace {
+
+struct Options {
+    bool csv = false;
+    bool quick = false;
+    uint32_t duration_millis = 2000;
+    uint32_t items_per_second = 2000;
+    uint32_t replies_per_second = 0;
+    uint32_t host_loop_micros = 1000;
+    uint32_t dongle_loop_micros = 250;
+    uint8_t hosts = 1;
+    bool batch = false;
+    bool irq = false;
+    bool reliable = false;
+    bool repeater = false;
+    uint8_t policy = 0;
+    bool adaptive = false;
+    uint8_t migrate = 0;
+    uint16_t grace = 500;
+    uint16_t budget = 0;
+    uint8_t delta = 0;
+    uint16_t keepalive = 0;
+    uint16_t wake = 0;
+    uint16_t pairing = 0;
+    bool cross_talk = false;
+    nrf_sim::Config air;
+
+    Options() {
+        this->air.loss = 0.02;
+        this->air.ack_loss = 0.01;
+        this->air.burst_loss = 0.6;
+        this->air.burst_enter = 0.001;
+        this->air.burst_exit = 0.05;
+        this->air.noisy_first = 1;
+        this->air.noisy_last = 20;
+    }
+};
+
+struct Config {
+    LinkSettings settings;
+    size_t data_size;
+    size_t max_packets;
+    uint8_t hosts;
+};
+
+struct Result {
+    bool paired = false;
+    uint64_t pair_micros = 0;
+    uint64_t offered = 0;
+    uint64_t accepted = 0;
+    uint64_t delivered = 0;
+    uint64_t duplicates = 0;
+    double offered_per_second = 0;
+    double delivered_per_second = 0;
+    uint64_t p50_micros = 0;
+    uint64_t p99_micros = 0;
+    uint64_t max_micros = 0;
+    double replies_per_second = 0;
+    uint64_t reply_p50_micros = 0;
+    double update_avg_micros = 0;
+    uint64_t update_max_micros = 0;
+    double update_cpu_nanos = 0;
+    double read_cpu_nanos = 0;
+    uint8_t queue_high_water = 0;
+    uint8_t rx_high_water = 0;
+    uint8_t end_rate = 0;
+    uint8_t end_channel = 0;
+    // percent of the time the dongle's radio was listening
+    double awake_percent = 100;
+    // the repeater's downstream hop, see Relay, the items forwarded there
+    // that never reached the dongle, and those the repeater had not heard
+    // the outcome of yet when the run ended
+    uint64_t hop_lost = 0;
+    uint64_t hop_missed = 0;
+    uint64_t hop_pending = 0;
+    uint32_t hop_avg_micros = 0;
+};
+
+// the top byte of a sequence number is the flow it belongs to,
+// so the dongle can tell the hosts' items apart
+const uint8_t flow_shift = 24;
+
+// one direction of traffic: items produced at a fixed rate on one end
+// and read on the other, with the time each one was produced
+struct Flow {
+    uint32_t tag = 0;
+    uint32_t items_per_second = 0;
+    uint64_t produced_micros = 0;
+    double credit = 0;
+    uint64_t offered = 0;
+    uint64_t accepted = 0;
+    uint64_t duplicates = 0;
+    std::vector<uint64_t> sent_at;
+    std::vector<bool> received;
+    std::vector<uint64_t> latencies;
+
+    void start(uint8_t index, uint32_t items_per_second, uint64_t now) {
+        this->tag = (uint32_t)index << flow_shift;
+        this->items_per_second = items_per_second;
+        this->produced_micros = now;
+    }
+
+    // send the items due since the last call
+    void produce(Endpoint *from) {
+        uint64_t now = nrf_sim::clock().now();
+        this->credit += (double)this->items_per_second * (now - this->produced_micros) / 1000000.0;
+        this->produced_micros = now;
+        while (this->credit >= 1.0) {
+            this->credit -= 1.0;
+            uint32_t seq = this->tag | (uint32_t)this->sent_at.size();
+            this->offered++;
+            if (from->send(seq)) {
+                this->accepted++;
+            }
+            this->sent_at.push_back(now);
+            this->received.push_back(false);
+        }
+    }
+
+    // an item of this flow arrived
+    void record(uint32_t seq) {
+        seq &= (1u << flow_shift) - 1;
+        if (seq >= this->sent_at.size()) {
+            return;
+        }
+        if (this->received[seq]) {
+            this->duplicates++;
+            return;
+        }
+        this->received[seq] = true;
+        this->latencies.push_back(nrf_sim::clock().now() - this->sent_at[seq]);
+    }
+};
+
+// read everything available, handing each item to its flow,
+// one read() at a time or in batches, returns how many were read
+size_t consume(Endpoint *to, std::vector<Flow> &flows, bool batch) {
+    uint32_t seqs[64];
+    size_t total = 0;
+    size_t count;
+    do {
+        if (batch) {
+            count = to->read_batch(seqs, 64);
+        } else {
+            count = to->read(seqs[0]) ? 1 : 0;
+        }
+        for (size_t i = 0; i < count; i++) {
+            uint32_t index = seqs[i] >> flow_shift;
+            if (index < flows.size()) {
+                flows[index].record(seqs[i]);
+            }
+        }
+        total += count;
+    } while (count > 0);
+    return total;
+}
+
+// the repeater's loop, which runs as a clock task next to the dongle's
+void relay_loop(void *context) {
+    ((Relay *)context)->update();
+}
+
+// items the repeater forwarded without hearing yet if they were delivered
+uint64_t relay_pending(Relay *relay) {
+    uint64_t reported = relay->hop_delivered() + relay->hop_lost();
+    return relay->hop_forwarded() - std::min(relay->hop_forwarded(), reported);
+}
+
+// state shared with the dongle's loop, which runs as a clock task
+struct DongleLoop {
+    Endpoint *dongle;
+    std::vector<Flow> *data;
+    Flow *replies;
+    bool measuring;
+    bool batch;
+    uint64_t update_calls;
+    double update_cpu_nanos;
+    uint64_t read_items;
+    double read_cpu_nanos;
+    // measured loops, and those the dongle's radio was listening in
+    uint64_t loops;
+    uint64_t awake_loops;
+};
+
+void dongle_loop(void *context) {
+    DongleLoop *loop = (DongleLoop *)context;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    loop->dongle->update();
+    loop->update_cpu_nanos += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    loop->update_calls++;
+
+    start = std::chrono::steady_clock::now();
+    loop->read_items += consume(loop->dongle, *loop->data, loop->batch);
+    loop->read_cpu_nanos += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    if (loop->measuring) {
+        loop->replies->produce(loop->dongle);
+        loop->loops++;
+        loop->awake_loops += loop->dongle->asleep() ? 0 : 1;
+    }
+}
+
+// a dongle's loop for --pairing, there is nothing to read
+void endpoint_loop(void *context) {
+    ((Endpoint *)context)->update();
+}
+
+// a host's loop for --pairing, and when it paired on its own board
+struct PairingLoop {
+    Endpoint *host;
+    uint64_t paired_micros;
+};
+
+void pairing_loop(void *context) {
+    PairingLoop *loop = (PairingLoop *)context;
+    loop->host->update();
+    if (loop->paired_micros == 0 && loop->host->is_paired()) {
+        loop->paired_micros = nrf_sim::clock().local();
+    }
+}
+
+uint64_t percentile(const std::vector<uint64_t> &sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t index = (size_t)(p * (sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+Result run(const Config &config, const Options &options) {
+    Result result;
+    nrf_sim::reset(options.air);
+    nrf_sim::Clock &clock = nrf_sim::clock();
+
+    // one dongle, and config.hosts hosts each with their own unique_id,
+    // a single host is paired with a dongle built for one host
+    SimRadio host_radios[bench_max_hosts];
+    SimRadio dongle_radio;
+    std::vector<Endpoint *> hosts;
+    for (uint8_t i = 0; i < config.hosts; i++) {
+        LinkSettings settings = config.settings;
+        settings.unique_id += i;
+        if (options.reliable) {
+            hosts.push_back(make_reliable_host(host_radios[i], settings, config.data_size, config.max_packets));
+        } else {
+            hosts.push_back(make_host(host_radios[i], settings, config.data_size, config.max_packets));
+        }
+    }
+    // with a repeater, the hosts pair with it and it pairs with
+    // the dongle, under the next program id
+    LinkSettings dongle_settings = config.settings;
+    SimRadio relay_radios[2];
+    Relay *relay = nullptr;
+    if (options.repeater) {
+        dongle_settings.program_id++;
+        relay = make_repeater(relay_radios[0], relay_radios[1], config.settings, config.data_size, config.max_packets);
+    }
+    Endpoint *dongle;
+    if (config.hosts > 1 && !options.repeater) {
+        dongle = make_multi_dongle(dongle_radio, dongle_settings, config.data_size, config.max_packets);
+    } else if (options.irq) {
+        dongle = make_irq_dongle(dongle_radio, dongle_settings, config.data_size, config.max_packets);
+    } else {
+        dongle = make_dongle(dongle_radio, dongle_settings, config.data_size, config.max_packets);
+    }
+
+    std::vector<Flow> data(config.hosts);
+    std::vector<Flow> replies(1);
+    DongleLoop loop = {dongle, &data, &replies[0], false, options.batch, 0, 0.0, 0, 0.0, 0, 0};
+
+    dongle->begin();
+    for (Endpoint *host : hosts) {
+        host->begin();
+    }
+    clock.add_task(options.dongle_loop_micros, dongle_loop, &loop);
+    if (relay != nullptr) {
+        relay->begin();
+        clock.add_task(options.dongle_loop_micros, relay_loop, relay);
+    }
+
+    // pair every host (and the repeater), giving up after two seconds
+    result.paired = false;
+    while (!result.paired && clock.now() < 2000000) {
+        result.paired = relay == nullptr || relay->is_paired();
+        for (Endpoint *host : hosts) {
+            host->update();
+            result.paired = result.paired && host->is_paired();
+        }
+        clock.advance(options.host_loop_micros);
+    }
+    result.pair_micros = clock.now();
+
+    uint64_t start_micros = clock.now();
+    uint64_t end_micros = start_micros + (uint64_t)options.duration_millis * 1000;
+    uint64_t next_loop = start_micros;
+    double update_total_micros = 0;
+    uint64_t update_calls = 0;
+    double host_cpu_nanos = 0;
+
+    for (uint8_t i = 0; i < config.hosts; i++) {
+        data[i].start(i, options.items_per_second, start_micros);
+    }
+    replies[0].start(0, options.replies_per_second, start_micros);
+    loop.measuring = true;
+
+    while (result.paired && clock.now() < end_micros) {
+        for (uint8_t i = 0; i < config.hosts; i++) {
+            // produce the offered load for the time since the last iteration
+            data[i].produce(hosts[i]);
+
+            uint64_t before = clock.now();
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            hosts[i]->update();
+            host_cpu_nanos += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            uint64_t spent = clock.now() - before;
+            update_total_micros += spent;
+            update_calls++;
+            result.update_max_micros = std::max(result.update_max_micros, spent);
+        }
+
+        // the dongle replies to the first host only
+        consume(hosts[0], replies, false);
+
+        // wait for the next loop iteration, or run late if update() overran
+        next_loop += options.host_loop_micros;
+        if (clock.now() < next_loop) {
+            clock.advance(next_loop - clock.now());
+        } else {
+            next_loop = clock.now();
+        }
+    }
+    loop.measuring = false;
+
+    // let the last frames arrive, and the repeater hear how the items
+    // it forwarded did, for up to a second more, so hop_lost can be
+    // checked against what the dongle missed
+    clock.advance(50000);
+    for (uint32_t waited = 0; relay != nullptr && relay_pending(relay) > 0 && waited < 1000; waited++) {
+        clock.advance(1000);
+    }
+
+    double seconds = (double)(end_micros - start_micros) / 1000000.0;
+    std::vector<uint64_t> latencies;
+    for (const Flow &flow : data) {
+        result.offered += flow.offered;
+        result.accepted += flow.accepted;
+        result.duplicates += flow.duplicates;
+        latencies.insert(latencies.end(), flow.latencies.begin(), flow.latencies.end());
+    }
+    result.delivered = latencies.size();
+    result.offered_per_second = result.offered / seconds;
+    result.delivered_per_second = result.paired ? result.delivered / seconds : 0;
+    std::sort(latencies.begin(), latencies.end());
+    result.p50_micros = percentile(latencies, 0.50);
+    result.p99_micros = percentile(latencies, 0.99);
+    result.max_micros = latencies.empty() ? 0 : latencies.back();
+    result.replies_per_second = result.paired ? replies[0].latencies.size() / seconds : 0;
+    std::sort(replies[0].latencies.begin(), replies[0].latencies.end());
+    result.reply_p50_micros = percentile(replies[0].latencies, 0.50);
+    result.update_avg_micros = update_calls ? update_total_micros / update_calls : 0;
+    result.update_cpu_nanos = (update_calls + loop.update_calls) ? (host_cpu_nanos + loop.update_cpu_nanos) / (update_calls + loop.update_calls) : 0;
+    result.read_cpu_nanos = loop.read_items ? loop.read_cpu_nanos / loop.read_items : 0;
+    for (Endpoint *host : hosts) {
+        result.queue_high_water = std::max(result.queue_high_water, host->high_water_mark());
+    }
+    result.rx_high_water = dongle->high_water_mark();
+    result.awake_percent = loop.loops ? 100.0 * loop.awake_loops / loop.loops : 100;
+    result.end_rate = hosts[0]->data_rate();
+    result.end_channel = hosts[0]->channel();
+    if (relay != nullptr) {
+        uint64_t forwarded = relay->hop_forwarded();
+        uint64_t arrived = result.delivered + result.duplicates;
+        result.hop_lost = relay->hop_lost();
+        result.hop_missed = forwarded - std::min(forwarded, arrived);
+        result.hop_pending = relay_pending(relay);
+        result.hop_avg_micros = relay->hop_avg_micros();
+        clock.remove_task(relay_loop, relay);
+        delete relay;
+    }
+
+    clock.remove_task(dongle_loop, &loop);
+    for (Endpoint *host : hosts) {
+        delete host;
+    }
+    delete dongle;
+    return result;
+}
+
+// --pairing: hosts hosts boot at once, each a clock task on its own board
+// (nrf_sim::Config::parallel) so their pairing packets can collide,
+// and pair with one dongle per bench_max_hosts of them
+struct PairingResult {
+    uint16_t dongles = 0;
+    uint16_t paired = 0;
+    uint64_t p50_micros = 0;
+    uint64_t p90_micros = 0;
+    uint64_t p99_micros = 0;
+    uint64_t max_micros = 0;
+    uint64_t collisions = 0;
+};
+
+PairingResult run_pairing(uint16_t hosts, const Options &options) {
+    PairingResult result;
+    nrf_sim::Config air = options.air;
+    air.parallel = true;
+    nrf_sim::reset(air);
+    nrf_sim::Clock &clock = nrf_sim::clock();
+
+    LinkSettings settings;
+    settings.unique_id = 0x12345678ABull;
+    settings.program_id = 7;
+    settings.ping_interval_millis = 1000;
+    settings.data_rate = SIM_1MBPS;
+    settings.power_level = SIM_PA_HIGH;
+    settings.retry_delay = 5;
+    settings.retry_count = 15;
+    settings.burst_budget_micros = 0;
+    settings.max_items_per_packet = 0;
+    settings.overflow_policy = options.policy;
+    settings.adaptive = false;
+    settings.migration_threshold = 0;
+    settings.reconnect_grace_millis = options.grace;
+    // blocking hosts would hold the clock while the others wait
+    settings.update_budget_micros = options.budget > 0 ? options.budget : 500;
+    settings.delta_keyframes = 0;
+    settings.max_ping_interval_millis = 0;
+    settings.wake_interval_millis = 0;
+
+    // each dongle takes its address from its first host's unique_id,
+    // which may be numbered one after the other
+    result.dongles = (hosts + bench_max_hosts - 1) / bench_max_hosts;
+    std::vector<SimRadio> radios(hosts + result.dongles);
+    std::vector<Endpoint *> dongles;
+    for (uint16_t i = 0; i < result.dongles; i++) {
+        dongles.push_back(make_multi_dongle(radios[hosts + i], settings, 4, 16));
+        dongles.back()->begin();
+        clock.add_task(options.dongle_loop_micros, endpoint_loop, dongles.back());
+    }
+    std::vector<PairingLoop> loops(hosts);
+    for (uint16_t i = 0; i < hosts; i++) {
+        LinkSettings host_settings = settings;
+        host_settings.unique_id += i;
+        loops[i].host = make_host(radios[i], host_settings, 4, 16);
+        loops[i].paired_micros = 0;
+        loops[i].host->begin();
+        clock.add_task(options.host_loop_micros, pairing_loop, &loops[i]);
+    }
+
+    // hosts that have not paired in ten seconds count as not paired
+    clock.advance(10000000);
+
+    std::vector<uint64_t> times;
+    for (PairingLoop &loop : loops) {
+        if (loop.paired_micros > 0) {
+            times.push_back(loop.paired_micros);
+        }
+    }
+    std::sort(times.begin(), times.end());
+    result.paired = (uint16_t)times.size();
+    result.p50_micros = percentile(times, 0.50);
+    result.p90_micros = percentile(times, 0.90);
+    result.p99_micros = percentile(times, 0.99);
+    result.max_micros = times.empty() ? 0 : times.back();
+    result.collisions = nrf_sim::air().collisions;
+
+    for (PairingLoop &loop : loops) {
+        clock.remove_task(pairing_loop, &loop);
+        delete loop.host;
+    }
+    for (Endpoint *dongle : dongles) {
+        clock.remove_task(endpoint_loop, dongle);
+        delete dongle;
+    }
+    return result;
+}
+
+void print_pairing(uint16_t hosts, const PairingResult &result, const Options &options) {
+    if (options.csv) {
+        printf("%u,%u,%u,%.1f,%.1f,%.1f,%.1f,%llu\n",
+               hosts, result.dongles, result.paired,
+               result.p50_micros / 1000.0, result.p90_micros / 1000.0, result.p99_micros / 1000.0, result.max_micros / 1000.0,
+               (unsigned long long)result.collisions);
+    } else {
+        printf("%5u %7u %6u %8.1f %8.1f %8.1f %8.1f %10llu\n",
+               hosts, result.dongles, result.paired,
+               result.p50_micros / 1000.0, result.p90_micros / 1000.0, result.p99_micros / 1000.0, result.max_micros / 1000.0,
+               (unsigned long long)result.collisions);
+    }
+    fflush(stdout);
+}
+
+// time to pair for 1, 2, 5, 10, 20, 50 hosts, up to options.pairing
+void sweep_pairing(const Options &options) {
+    if (options.csv) {
+        printf("hosts,dongles,paired,p50_ms,p90_ms,p99_ms,max_ms,collisions\n");
+    } else {
+        printf("%5s %7s %6s %8s %8s %8s %8s %10s\n", "hosts", "dongles", "paired", "p50_ms", "p90_ms", "p99_ms", "max_ms", "collisions");
+    }
+
+    const uint16_t counts[] = {1, 2, 5, 10, 20, 50};
+    for (uint16_t hosts : counts) {
+        if (hosts < options.pairing) {
+            print_pairing(hosts, run_pairing(hosts, options), options);
+        }
+    }
+    print_pairing(options.pairing, run_pairing(options.pairing, options), options);
+}
+
+// --cross-talk: two dongles, one host each, and two hosts whose unique_ids
+// differ only in the low byte, 73 apart so that their default channels are
+// the same too. each host sends its own numbers (its index in the top byte,
+// see flow_shift) and each dongle must only read those of one of them
+struct CrossTalkLoop {
+    Endpoint *endpoint;
+    uint32_t flow;
+    uint32_t sent;
+    // dongles only, items read from each flow, and out of order
+    uint64_t read[2];
+    uint64_t out_of_order;
+    uint32_t next[2];
+};
+
+void cross_talk_host_loop(void *context) {
+    CrossTalkLoop *loop = (CrossTalkLoop *)context;
+    loop->endpoint->update();
+    if (loop->endpoint->is_paired() && loop->endpoint->send((loop->flow << flow_shift) | loop->sent)) {
+        loop->sent++;
+    }
+}
+
+void cross_talk_dongle_loop(void *context) {
+    CrossTalkLoop *loop = (CrossTalkLoop *)context;
+    loop->endpoint->update();
+    uint32_t seq;
+    while (loop->endpoint->read(seq)) {
+        uint32_t flow = seq >> flow_shift;
+        uint32_t number = seq & ((1u << flow_shift) - 1);
+        if (flow > 1) {
+            continue;
+        }
+        loop->read[flow]++;
+        if (number < loop->next[flow]) {
+            loop->out_of_order++;
+        }
+        loop->next[flow] = number + 1;
+    }
+}
+
+int run_cross_talk(const Options &options) {
+    nrf_sim::Config air = options.air;
+    air.parallel = true;
+    nrf_sim::reset(air);
+    nrf_sim::Clock &clock = nrf_sim::clock();
+
+    LinkSettings settings;
+    settings.unique_id = 0x12345678ABull;
+    settings.program_id = 7;
+    settings.ping_interval_millis = 100;
+    settings.data_rate = SIM_1MBPS;
+    settings.power_level = SIM_PA_HIGH;
+    settings.retry_delay = 5;
+    settings.retry_count = 15;
+    settings.burst_budget_micros = 0;
+    settings.max_items_per_packet = 0;
+    settings.overflow_policy = options.policy;
+    settings.adaptive = false;
+    settings.migration_threshold = 0;
+    settings.reconnect_grace_millis = options.grace;
+    // blocking hosts would hold the clock while the other waits
+    settings.update_budget_micros = options.budget > 0 ? options.budget : 500;
+    settings.delta_keyframes = 0;
+    settings.max_ping_interval_millis = 0;
+    settings.wake_interval_millis = 0;
+
+    SimRadio radios[4];
+    CrossTalkLoop hosts[2] = {};
+    CrossTalkLoop dongles[2] = {};
+    for (uint8_t i = 0; i < 2; i++) {
+        // the dongles are built alike, only their hosts tell them apart
+        dongles[i].endpoint = make_dongle(radios[2 + i], settings, 4, 64);
+        dongles[i].endpoint->begin();
+        clock.add_task(options.dongle_loop_micros, cross_talk_dongle_loop, &dongles[i]);
+    }
+    for (uint8_t i = 0; i < 2; i++) {
+        LinkSettings host_settings = settings;
+        host_settings.unique_id += i * 73;
+        hosts[i].endpoint = make_host(radios[i], host_settings, 4, 64);
+        hosts[i].flow = i;
+        hosts[i].endpoint->begin();
+        clock.add_task(options.host_loop_micros, cross_talk_host_loop, &hosts[i]);
+    }
+
+    clock.advance((uint64_t)options.duration_millis * 1000);
+    for (CrossTalkLoop &loop : hosts) {
+        clock.remove_task(cross_talk_host_loop, &loop);
+    }
+    // let the last packets through
+    clock.advance(50000);
+
+    // each dongle read one flow, and not the same one
+    bool paired = hosts[0].endpoint->is_paired() && hosts[1].endpoint->is_paired();
+    bool apart = true;
+    for (CrossTalkLoop &dongle : dongles) {
+        apart = apart && (dongle.read[0] == 0) != (dongle.read[1] == 0) && dongle.out_of_order == 0;
+    }
+    apart = apart && (dongles[0].read[0] > 0) != (dongles[1].read[0] > 0);
+
+    if (options.csv) {
+        printf("dongle,flow0_read,flow1_read,out_of_order\n");
+    } else {
+        printf("host 0x%llx sent %u, host 0x%llx sent %u\n",
+               (unsigned long long)settings.unique_id, hosts[0].sent,
+               (unsigned long long)(settings.unique_id + 73), hosts[1].sent);
+        printf("%6s %10s %10s %12s\n", "dongle", "flow0_read", "flow1_read", "out_of_order");
+    }
+    for (uint8_t i = 0; i < 2; i++) {
+        printf(options.csv ? "%u,%llu,%llu,%llu\n" : "%6u %10llu %10llu %12llu\n", i,
+               (unsigned long long)dongles[i].read[0], (unsigned long long)dongles[i].read[1],
+               (unsigned long long)dongles[i].out_of_order);
+    }
+    printf("%s\n", paired && apart ? "PASS" : (paired ? "FAIL (cross-talk)" : "FAIL (not paired)"));
+
+    for (CrossTalkLoop &loop : dongles) {
+        clock.remove_task(cross_talk_dongle_loop, &loop);
+        delete loop.endpoint;
+    }
+    for (CrossTalkLoop &loop : hosts) {
+        delete loop.endpoint;
+    }
+    return paired && apart ? 0 : 1;
+}
+
+const char *rate_name(uint8_t data_rate) {
+    switch (data_rate) {
+        case SIM_250KBPS: return "250K";
+        case SIM_1MBPS: return "1M";
+        case SIM_2MBPS: return "2M";
+        default: return "?";
+    }
+}
+
+void print_header(const Options &options) {
+    if (options.csv) {
+        printf("data_rate,retry_delay,retry_count,ping_ms,burst_us,items_per_packet,max_packets,data_size,hosts,paired,offered_per_s,delivered_per_s,delivered_bytes_per_s,p50_us,p99_us,max_us,lost,dropped,duplicates,replies_per_s,reply_p50_us,update_avg_us,update_max_us,update_cpu_ns,read_cpu_ns,queue_high_water,rx_high_water,awake_percent,end_rate,end_channel,hop_avg_us,hop_lost,hop_missed\n");
+    } else {
+        printf("%-5s %3s %3s %5s %5s %5s %4s %4s %5s %9s %9s %9s %8s %8s %8s %7s %7s %5s %7s %8s %8s %8s %8s %7s %5s %6s %6s %4s %3s %6s %8s %8s\n",
+               "rate", "ard", "arc", "ping", "burst", "items", "maxp", "size", "hosts", "offered/s", "deliv/s", "bytes/s", "p50_us", "p99_us", "max_us",
+               "lost", "dropped", "dups", "rep/s", "rep_p50", "upd_avg", "upd_max", "cpu_ns", "read_ns", "q_hwm", "rx_hwm", "awake%", "end", "ch", "hop_us", "hop_lost", "hop_miss");
+    }
+}
+
+// items actually packed per packet, a fragmented item counts as one
+unsigned items_per_packet(const Config &config) {
+    unsigned fit = config.data_size > 32 - 2 ? 1 : (32 - 1) / config.data_size;
+    unsigned limit = config.settings.max_items_per_packet;
+    return limit > 0 && limit < fit ? limit : fit;
+}
+
+void print_result(const Config &config, const Result &result, const Options &options) {
+    uint64_t lost = result.accepted - std::min(result.accepted, result.delivered);
+    uint64_t dropped = result.offered - result.accepted;
+    // once the repeater has heard how every item did, the items the dongle
+    // missed are those it counted as lost. with ACKs that are never lost
+    // it knows exactly which items the dongle got, otherwise it can count
+    // some that arrived as lost
+    bool acks_kept = options.air.ack_loss == 0 && options.air.burst_enter == 0 && options.air.noisy_loss == 0;
+    bool hop_wrong = result.hop_pending > 0 || result.hop_missed > result.hop_lost || (acks_kept && result.hop_missed < result.hop_lost);
+    if (options.csv) {
+        printf("%s,%u,%u,%u,%u,%u,%zu,%zu,%u,%d,%.0f,%.1f,%.0f,%llu,%llu,%llu,%llu,%llu,%llu,%.1f,%llu,%.1f,%llu,%.0f,%.1f,%u,%u,%.1f,%s,%u,%u,%llu,%llu\n",
+               rate_name(config.settings.data_rate), config.settings.retry_delay, config.settings.retry_count,
+               config.settings.ping_interval_millis, config.settings.burst_budget_micros, items_per_packet(config), config.max_packets, config.data_size, config.hosts, result.paired ? 1 : 0,
+               result.offered_per_second, result.delivered_per_second, result.delivered_per_second * config.data_size,
+               (unsigned long long)result.p50_micros, (unsigned long long)result.p99_micros, (unsigned long long)result.max_micros,
+               (unsigned long long)lost, (unsigned long long)dropped, (unsigned long long)result.duplicates,
+               result.replies_per_second, (unsigned long long)result.reply_p50_micros,
+               result.update_avg_micros, (unsigned long long)result.update_max_micros, result.update_cpu_nanos, result.read_cpu_nanos,
+               result.queue_high_water, result.rx_high_water, result.awake_percent, rate_name(result.end_rate), result.end_channel,
+               result.hop_avg_micros, (unsigned long long)result.hop_lost, (unsigned long long)result.hop_missed);
+    } else {
+        printf("%-5s %3u %3u %5u %5u %5u %4zu %4zu %5u %9.0f %9.1f %9.0f %8llu %8llu %8llu %7llu %7llu %5llu %7.1f %8llu %8.1f %8llu %8.0f %7.1f %5u %6u %6.1f %4s %3u %6u %8llu %8llu%s%s\n",
+               rate_name(config.settings.data_rate), config.settings.retry_delay, config.settings.retry_count,
+               config.settings.ping_interval_millis, config.settings.burst_budget_micros, items_per_packet(config), config.max_packets, config.data_size, config.hosts,
+               result.offered_per_second, result.delivered_per_second, result.delivered_per_second * config.data_size,
+               (unsigned long long)result.p50_micros, (unsigned long long)result.p99_micros, (unsigned long long)result.max_micros,
+               (unsigned long long)lost, (unsigned long long)dropped, (unsigned long long)result.duplicates,
+               result.replies_per_second, (unsigned long long)result.reply_p50_micros,
+               result.update_avg_micros, (unsigned long long)result.update_max_micros, result.update_cpu_nanos, result.read_cpu_nanos,
+               result.queue_high_water, result.rx_high_water, result.awake_percent, rate_name(result.end_rate), result.end_channel,
+               result.hop_avg_micros, (unsigned long long)result.hop_lost, (unsigned long long)result.hop_missed,
+               result.paired ? "" : "  (not paired)",
+               hop_wrong ? "  (hop_lost is not what the dongle missed)" : "");
+    }
+    fflush(stdout);
+}
+
+void usage() {
+    printf("usage: benchmark [options]\n"
+           "    --csv               print csv instead of a table\n"
+           "    --quick             sweep a few configurations only\n"
+           "    --batch             read on the dongle in place (peek / consume)\n"
+           "    --irq               receive on the dongle from the radio's interrupt (one host)\n"
+           "    --reliable          number packets and resend them until acknowledged, in order\n"
+           "    --repeater          send through a repeater, a second hop to the dongle\n"
+           "    --adaptive          adapt the data rate, PA level and retries on the hosts\n"
+           "    --pairing N         time how long up to N hosts booted together take to pair, 1-100,\n"
+           "                        non-blocking (--budget, default 500 here) instead of the sweep\n"
+           "    --cross-talk        check two dongles paired with hosts whose ids differ only\n"
+           "                        in the low byte read only their own host's items\n"
+           "    --duration MS       virtual time measured per configuration (default 2000)\n"
+           "    --rate N            offered items per second, per host (default 2000)\n"
+           "    --hosts N           hosts sending to the dongle, 1-5 (default 1)\n"
+           "    --policy P          what full buffers do with new items:\n"
+           "                        oldest (drop the oldest, default), newest (drop it), reject\n"
+           "    --reply-rate N      replies per second sent back by the dongle (default 0)\n"
+           "    --host-loop US      host loop period in microseconds (default 1000)\n"
+           "    --dongle-loop US    dongle loop period in microseconds (default 250)\n"
+           "    --loss P            frame loss probability (default 0.02)\n"
+           "    --ack-loss P        ACK loss probability (default 0.01)\n"
+           "    --burst-loss P      loss probability during a burst (default 0.6)\n"
+           "    --burst-enter P     per frame probability of entering a burst (default 0.001)\n"
+           "    --burst-exit P      per frame probability of leaving a burst (default 0.05)\n"
+           "    --noise P           interference loss probability on the noisy band (default 0)\n"
+           "    --noise-band A-B    channels with interference (default 1-20)\n"
+           "    --migrate PCT       move the link to a quieter channel above PCT%% loss\n"
+           "    --grace MS          look for a lost dongle this long before pairing again,\n"
+           "                        0 pairs again at once and drops the queue (default 500)\n"
+           "    --budget US         non-blocking host, spending up to US per update() (default 0, blocking)\n"
+           "    --delta N           send the bytes that changed, every N-th packet in full (default 0, off)\n"
+           "    --keepalive MS      let the ping interval grow up to MS while the link is clean (default 0, off)\n"
+           "    --wake MS           hosts send in wake windows MS apart, the dongle sleeps in between (default 0, off)\n"
+           "    --seed N            seed of the loss model\n");
+}
+
+bool parse(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (strcmp(arg, "--csv") == 0) {
+            options.csv = true;
+        } else if (strcmp(arg, "--quick") == 0) {
+            options.quick = true;
+        } else if (strcmp(arg, "--batch") == 0) {
+            options.batch = true;
+        } else if (strcmp(arg, "--irq") == 0) {
+            options.irq = true;
+        } else if (strcmp(arg, "--reliable") == 0) {
+            options.reliable = true;
+        } else if (strcmp(arg, "--repeater") == 0) {
+            options.repeater = true;
+        } else if (strcmp(arg, "--adaptive") == 0) {
+            options.adaptive = true;
+        } else if (strcmp(arg, "--cross-talk") == 0) {
+            options.cross_talk = true;
+        } else if (value == nullptr) {
+            return false;
+        } else {
+            i++;
+            if (strcmp(arg, "--duration") == 0) {
+                options.duration_millis = (uint32_t)strtoul(value, nullptr, 10);
+            } else if (strcmp(arg, "--rate") == 0) {
+                options.items_per_second = (uint32_t)strtoul(value, nullptr, 10);
+            } else if (strcmp(arg, "--hosts") == 0) {
+                options.hosts = (uint8_t)strtoul(value, nullptr, 10);
+            } else if (strcmp(arg, "--policy") == 0) {
+                if (strcmp(value, "oldest") == 0) {
+                    options.policy = 0;
+                } else if (strcmp(value, "newest") == 0) {
+                    options.policy = 1;
+                } else if (strcmp(value, "reject") == 0) {
+                    options.policy = 2;
+                } else {
+                    return false;
+                }
+            } else if (strcmp(arg, "--reply-rate") == 0) {
+                options.replies_per_second = (uint32_t)strtoul(value, nullptr, 10);
+            } else if (strcmp(arg, "--host-loop") == 0) {
+                options.host_loop_micros = (uint32_t)strtoul(value, nullptr, 10);
+            } else if (strcmp(arg, "--dongle-loop") == 0) {
+                options.dongle_loop_micros = (uint32_t)strtoul(value, nullptr, 10);
+            } else if (strcmp(arg, "--loss") == 0) {
+                options.air.loss = atof(value);
+            } else if (strcmp(arg, "--ack-loss") == 0) {
+                options.air.ack_loss = atof(value);
+            } else if (strcmp(arg, "--burst-loss") == 0) {
+                options.air.burst_loss = atof(value);
+            } else if (strcmp(arg, "--burst-enter") == 0) {
+                options.air.burst_enter = atof(value);
+            } else if (strcmp(arg, "--burst-exit") == 0) {
+                options.air.burst_exit = atof(value);
+            } else if (strcmp(arg, "--noise") == 0) {
+                options.air.noisy_loss = atof(value);
+            } else if (strcmp(arg, "--noise-band") == 0) {
+                unsigned first, last;
+                if (sscanf(value, "%u-%u", &first, &last) != 2 || first > last || last > 125) {
+                    return false;
+                }
+                options.air.noisy_first = (uint8_t)first;
+                options.air.noisy_last = (uint8_t)last;
+            } else if (strcmp(arg, "--migrate") == 0) {
+                options.migrate = (uint8_t)strtoul(value, nullptr, 10);
+            } else if (strcmp(arg, "--budget") == 0) {
+                options.budget = (uint16_t)strtoul(value, nullptr, 10);
+            } else if (strcmp(arg, "--delta") == 0) {
+                options.delta = (uint8_t)strtoul(value, nullptr, 10);
+            } else if (strcmp(arg, "--keepalive") == 0) {
+                options.keepalive = (uint16_t)strtoul(value, nullptr, 10);
+            } else if (strcmp(arg, "--wake") == 0) {
+                options.wake = (uint16_t)strtoul(value, nullptr, 10);
+            } else if (strcmp(arg, "--grace") == 0) {
+                options.grace = (uint16_t)strtoul(value, nullptr, 10);
+            } else if (strcmp(arg, "--pairing") == 0) {
+                options.pairing = (uint16_t)strtoul(value, nullptr, 10);
+                if (options.pairing < 1 || options.pairing > 100) {
+                    return false;
+                }
+            } else if (strcmp(arg, "--seed") == 0) {
+                options.air.seed = strtoull(value, nullptr, 0);
+            } else {
+                return false;
+            }
+        }
+    }
+    return options.host_loop_micros > 0 && options.dongle_loop_micros > 0 && options.hosts >= 1 && options.hosts <= bench_max_hosts;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parse(argc, argv, options)) {
+        usage();
+        return 1;
+    }
+
+    if (options.pairing > 0) {
+        sweep_pairing(options);
+        return 0;
+    }
+
+    if (options.cross_talk) {
+        return run_cross_talk(options);
+    }
+
+    std::vector<uint8_t> data_rates = {SIM_250KBPS, SIM_1MBPS, SIM_2MBPS};
+    std::vector<uint8_t> retry_delays = {1, 5, 15};
+    std::vector<uint8_t> retry_counts = {3, 15};
+    std::vector<uint16_t> ping_intervals = {100, 1000};
+    std::vector<uint16_t> burst_budgets = {0, 800};
+    std::vector<uint8_t> item_limits = {1, 0};
+    std::vector<size_t> max_packets(bench_max_packets, bench_max_packets + sizeof(bench_max_packets) / sizeof(bench_max_packets[0]));
+    std::vector<size_t> data_sizes(bench_data_sizes, bench_data_sizes + sizeof(bench_data_sizes) / sizeof(bench_data_sizes[0]));
+
+    if (options.quick) {
+        data_rates = {SIM_1MBPS, SIM_2MBPS};
+        retry_delays = {5};
+        retry_counts = {15};
+        ping_intervals = {1000};
+        burst_budgets = {0, 800};
+        item_limits = {1, 0};
+        max_packets = {16};
+        data_sizes = {4, 28, 256};
+        // the smallest fragmented size, where a numbering host and a plain
+        // dongle would disagree if the header decided fragmentation
+        if (options.reliable) {
+            data_sizes = {4, 28, 31, 256};
+        }
+    }
+
+    print_header(options);
+    for (uint8_t data_rate : data_rates) {
+    for (uint8_t retry_delay : retry_delays) {
+    for (uint8_t retry_count : retry_counts) {
+    for (uint16_t ping_interval : ping_intervals) {
+    for (uint16_t burst_budget : burst_budgets) {
+    for (uint8_t item_limit : item_limits) {
+    for (size_t packets : max_packets) {
+    for (size_t size : data_sizes) {
+        Config config;
+        config.settings.unique_id = 0x12345678ABull;
+        config.settings.program_id = 7;
+        config.settings.ping_interval_millis = ping_interval;
+        config.settings.data_rate = data_rate;
+        config.settings.power_level = SIM_PA_HIGH;
+        config.settings.retry_delay = retry_delay;
+        config.settings.retry_count = retry_count;
+        config.settings.burst_budget_micros = burst_budget;
+        config.settings.max_items_per_packet = item_limit;
+        config.settings.overflow_policy = options.policy;
+        config.settings.adaptive = options.adaptive;
+        config.settings.migration_threshold = options.migrate;
+        config.settings.reconnect_grace_millis = options.grace;
+        config.settings.update_budget_micros = options.budget;
+        config.settings.delta_keyframes = options.delta;
+        config.settings.max_ping_interval_millis = options.keepalive;
+        config.settings.wake_interval_millis = options.wake;
+        config.data_size = size;
+        config.max_packets = packets;
+        config.hosts = options.hosts;
+        print_result(config, run(config, options), options);
+    }
+    }
+    }
+    }
+    }
+    }
+    }
+    }
+    return 0;
+}
@@ -0,0 +1,361 @@
+// Record stream decoder for NRFSerialSink (see nrf_stream.h)
+//
+// reads the records a dongle streams over its serial port and prints
+// one line per record: the dongle's micros(), the host and the item in hex,
+// and what was lost or damaged on the way once the stream ends
+//
+// --self-test streams from two simulated hosts through a simulated dongle
+// and its sink into a pseudo-terminal, decodes them from the other end as
+// from a real port, and checks every item arrived once, in order, intact
+//
+// build (from this directory):
+//     g++ -std=c++11 -O2 -pthread -o nrf_stream nrf_stream.cpp
+// run:
+//     ./nrf_stream /dev/ttyACM0              aligned text
+//     ./nrf_stream --csv --size 4 /dev/ttyACM0
+//     ./nrf_stream --self-test
+//     ./nrf_stream --help                    all options
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <poll.h>
+#include <signal.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "nrf_stream.h"
+
+// the self-test's dongle serves both its hosts
+#define NRF_MAX_HOSTS 2
+#define NRF_SIM
+#include "../../nrf_dongle.h"
+
+namespace {
+
+struct Options {
+    const char *path = nullptr;
+    uint32_t baud = 115200;
+    bool csv = false;
+    size_t size = 0;
+    uint64_t count = 0;
+    bool self_test = false;
+    uint32_t items = 20000;
+};
+
+volatile sig_atomic_t stopping = 0;
+
+void on_signal(int) {
+    stopping = 1;
+}
+
+void print_counters(const nrf_stream::Counters &counters) {
+    fprintf(stderr, "bytes %llu records %llu bad_frames %llu bad_crc %llu skipped %llu overruns %llu\n",
+        (unsigned long long)counters.bytes, (unsigned long long)counters.records,
+        (unsigned long long)counters.bad_frames, (unsigned long long)counters.bad_crc,
+        (unsigned long long)counters.skipped, (unsigned long long)counters.overruns);
+}
+
+void print_record(const nrf_stream::Record &record, bool csv) {
+    static const char hex[] = "0123456789abcdef";
+    char data[2 * 256 + 1];
+    size_t size = record.size < 256 ? record.size : 256;
+    for (size_t i = 0; i < size; i++) {
+        data[2 * i] = hex[record.data[i] >> 4];
+        data[2 * i + 1] = hex[record.data[i] & 0xF];
+    }
+    data[2 * size] = '\0';
+
+    if (csv) {
+        printf("%lu,%u,%s\n", (unsigned long)record.micros, record.source, data);
+    } else {
+        printf("%10lu %4u  %s\n", (unsigned long)record.micros, record.source, data);
+    }
+}
+
+// decode a port until it closes, count records are in, or ctrl-c
+int run(const Options &options) {
+    int fd = nrf_stream::open_tty(options.path, options.baud);
+    if (fd < 0) {
+        fprintf(stderr, "can not open %s: %s\n", options.path, strerror(errno));
+        return 1;
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    // one write per screenful rather than per line
+    static char out[1 << 16];
+    setvbuf(stdout, out, _IOFBF, sizeof(out));
+
+    if (options.csv) {
+        printf("micros,source,data\n");
+    } else {
+        printf("%10s %4s  %s\n", "micros", "src", "data");
+    }
+
+    nrf_stream::Decoder decoder;
+    decoder.set_record_size(options.size);
+    bool done = false;
+    while (!done && !stopping) {
+        ssize_t n = decoder.read_from(fd, [&](const nrf_stream::Record &record) {
+            if (done) {
+                return;
+            }
+            print_record(record, options.csv);
+            done = options.count > 0 && decoder.get_counters().records >= options.count;
+        });
+        if (n == 0 || (n < 0 && errno != EINTR)) {
+            break;
+        }
+    }
+
+    fflush(stdout);
+    print_counters(decoder.get_counters());
+    close(fd);
+    return 0;
+}
+
+// the self-test's item, a sequence number (its low bytes are mostly
+// zeros, which COBS has to take out) and a pattern derived from it
+struct Item {
+    uint32_t seq;
+    uint8_t pattern[12];
+};
+
+void fill(Item &item, uint32_t seq) {
+    item.seq = seq;
+    for (uint8_t i = 0; i < sizeof(item.pattern); i++) {
+        item.pattern[i] = (uint8_t)(seq * 31 + i * 7);
+    }
+}
+
+typedef NRFLink<NRFHostRole, NRFSimBackend, Item, 16> Host;
+typedef NRFLink<NRFDongleRole, NRFSimBackend, Item, 16> Dongle;
+typedef NRFSerialSink<NRFSimBackend, Item, 16> Sink;
+
+// the pty's master end, as the dongle's serial port
+class PtyPrint : public Print {
+    public:
+        explicit PtyPrint(int fd) : fd(fd) {}
+
+        size_t write(uint8_t byte) {
+            return this->write(&byte, 1);
+        }
+
+        size_t write(const uint8_t *buffer, size_t size) {
+            this->writes++;
+            size_t written = 0;
+            while (written < size) {
+                ssize_t n = ::write(this->fd, buffer + written, size - written);
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (n <= 0) {
+                    break;
+                }
+                written += n;
+            }
+            this->bytes += written;
+            return written;
+        }
+
+        uint64_t writes = 0;
+        uint64_t bytes = 0;
+
+    private:
+        int fd;
+};
+
+struct DongleLoop {
+    Dongle *dongle;
+    Sink *sink;
+};
+
+void dongle_loop(void *context) {
+    DongleLoop *loop = (DongleLoop *)context;
+    loop->dongle->update();
+    loop->sink->update();
+}
+
+struct Check {
+    uint32_t next[NRF_MAX_HOSTS] = {};
+    uint64_t out_of_order = 0;
+    uint64_t corrupt = 0;
+};
+
+int self_test(const Options &options) {
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        fprintf(stderr, "can not open a pseudo-terminal: %s\n", strerror(errno));
+        return 1;
+    }
+    const char *path = ptsname(master);
+    int fd = nrf_stream::open_tty(path, options.baud);
+    if (fd < 0) {
+        fprintf(stderr, "can not open %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    // read the pty as the decoder would a port, while the dongle writes,
+    // until every item is in or nothing came for a second
+    uint64_t expected = (uint64_t)options.items * NRF_MAX_HOSTS;
+    nrf_stream::Decoder decoder;
+    decoder.set_record_size(sizeof(Item));
+    Check check;
+    std::atomic<bool> writing(true);
+    std::thread reader([&]() {
+        struct pollfd pfd = {fd, POLLIN, 0};
+        while (decoder.get_counters().records < expected) {
+            int ready = poll(&pfd, 1, 1000);
+            if (ready == 0 && !writing) {
+                break;
+            }
+            if (ready <= 0) {
+                continue;
+            }
+            decoder.read_from(fd, [&](const nrf_stream::Record &record) {
+                Item item;
+                memcpy(&item, record.data, sizeof(item));
+                Item want;
+                fill(want, item.seq);
+                if (record.source >= NRF_MAX_HOSTS || memcmp(&item, &want, sizeof(item)) != 0) {
+                    check.corrupt++;
+                    return;
+                }
+                if (item.seq != check.next[record.source]) {
+                    check.out_of_order++;
+                }
+                check.next[record.source] = item.seq + 1;
+            });
+        }
+    });
+
+    // a lossless air, so every item sent reaches the dongle
+    nrf_sim::Config config;
+    config.loss = 0;
+    config.ack_loss = 0;
+    config.burst_loss = 0;
+    nrf_sim::reset(config);
+    nrf_sim::Clock &clock = nrf_sim::clock();
+
+    SimRadio dongle_radio;
+    SimRadio host_radios[NRF_MAX_HOSTS];
+    Dongle dongle(dongle_radio, 0, 7, 0, 0, SIM_2MBPS, SIM_PA_HIGH, 5, 15);
+    PtyPrint port(master);
+    Sink sink(dongle, port);
+    DongleLoop loop = {&dongle, &sink};
+    dongle.begin();
+    clock.add_task(250, dongle_loop, &loop);
+
+    std::vector<Host *> hosts;
+    for (uint8_t i = 0; i < NRF_MAX_HOSTS; i++) {
+        hosts.push_back(new Host(host_radios[i], 0x100 + i, 7, 100, 0, SIM_2MBPS, SIM_PA_HIGH, 5, 15));
+        hosts.back()->set_overflow_policy(_QUEUE_REJECT_);
+        hosts.back()->begin();
+    }
+
+    // each host sends an item every loop, and again when its queue was full
+    uint32_t sent[NRF_MAX_HOSTS] = {};
+    bool all_sent = false;
+    while (!all_sent && clock.now() < 600000000) {
+        all_sent = true;
+        for (uint8_t i = 0; i < NRF_MAX_HOSTS; i++) {
+            hosts[i]->update();
+            if (hosts[i]->is_paired() && sent[i] < options.items) {
+                Item item;
+                fill(item, sent[i]);
+                if (hosts[i]->send(item)) {
+                    sent[i]++;
+                }
+            }
+            all_sent = all_sent && sent[i] == options.items;
+        }
+        clock.advance(500);
+    }
+    // let the last packets through, and out of the sink
+    for (uint8_t n = 0; n < 100; n++) {
+        for (Host *host : hosts) {
+            host->update();
+        }
+        clock.advance(1000);
+    }
+    sink.flush();
+    writing = false;
+    reader.join();
+
+    for (Host *host : hosts) {
+        delete host;
+    }
+    clock.remove_task(dongle_loop, &loop);
+    close(fd);
+    close(master);
+
+    const nrf_stream::Counters &counters = decoder.get_counters();
+    uint64_t missing = 0;
+    for (uint8_t i = 0; i < NRF_MAX_HOSTS; i++) {
+        missing += options.items - check.next[i];
+    }
+    bool passed = all_sent && counters.records == expected && missing == 0 && sink.get_dropped_records() == 0
+        && check.out_of_order == 0 && check.corrupt == 0
+        && counters.bad_frames == 0 && counters.bad_crc == 0 && counters.skipped == 0;
+
+    printf("items %llu records %llu missing %llu out_of_order %llu corrupt %llu\n",
+        (unsigned long long)expected, (unsigned long long)counters.records, (unsigned long long)missing,
+        (unsigned long long)check.out_of_order, (unsigned long long)check.corrupt);
+    printf("bytes %llu in %llu writes, %.1f bytes per write, %.1f bytes per record, %lu dropped\n",
+        (unsigned long long)port.bytes, (unsigned long long)port.writes,
+        port.writes ? (double)port.bytes / port.writes : 0.0,
+        counters.records ? (double)port.bytes / counters.records : 0.0,
+        (unsigned long)sink.get_dropped_records());
+    print_counters(counters);
+    printf("%s\n", passed ? "PASS" : "FAIL");
+    return passed ? 0 : 1;
+}
+
+void usage() {
+    printf("usage: nrf_stream [options] <tty>\n"
+           "       nrf_stream --self-test [--items N]\n"
+           "  --baud N       port speed, ignored by USB serial (default 115200)\n"
+           "  --csv          csv output\n"
+           "  --size N       only records whose item is N bytes, sizeof(TData)\n"
+           "  --count N      stop after N records\n"
+           "  --self-test    stream through a simulated dongle into a pseudo-terminal and check it\n"
+           "  --items N      items per host in the self-test (default 20000)\n");
+}
+
+bool parse(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (strcmp(arg, "--baud") == 0 && has_value) {
+            options.baud = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--csv") == 0) {
+            options.csv = true;
+        } else if (strcmp(arg, "--size") == 0 && has_value) {
+            options.size = (size_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--count") == 0 && has_value) {
+            options.count = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--self-test") == 0) {
+            options.self_test = true;
+        } else if (strcmp(arg, "--items") == 0 && has_value) {
+            options.items = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (arg[0] != '-' && options.path == nullptr) {
+            options.path = arg;
+        } else {
+            return false;
+        }
+    }
+    return options.self_test ? options.items > 0 : options.path != nullptr;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parse(argc, argv, options)) {
+        usage();
+        return 2;
+    }
+    return options.self_test ? self_test(options) : run(options);
+}
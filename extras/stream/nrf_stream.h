@@ -0,0 +1,258 @@
+#ifndef NRF_STREAM_H
+#define NRF_STREAM_H
+
+// ============ NOTE ============
+// Decoder for the record stream NRFSerialSink (nrf_dongle.h) writes,
+// for Linux, reading from a tty (the dongle's serial port) or a pty
+// ==============================
+
+// each record is COBS encoded and followed by a zero byte:
+//     micros() on the dongle when it took the item (4 bytes, little endian)
+//     the host it came from (1 byte)
+//     the item (sizeof(TData) bytes, as they are in the dongle's memory)
+//     CRC-16/CCITT-FALSE of all of the above (2 bytes, little endian)
+// the decoder reads into one buffer and decodes each frame in place
+// (COBS never grows when decoded), so a record's item is handed out
+// where it was read, and only the unfinished frame at the end is ever
+// moved, to the front of the buffer when it fills up
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#include <vector>
+
+namespace nrf_stream {
+
+// a decoded record, data points into the decoder's buffer
+// and is only valid in the callback it is passed to
+struct Record {
+    uint32_t micros;
+    uint8_t source;
+    const uint8_t *data;
+    size_t size;
+};
+
+struct Counters {
+    // bytes read, and records decoded
+    uint64_t bytes = 0;
+    uint64_t records = 0;
+    // frames that were not a record: bad COBS, too short, or another
+    // size than set_record_size() expects, and records with a bad CRC
+    uint64_t bad_frames = 0;
+    uint64_t bad_crc = 0;
+    // the first frame, which is left out of the above, as the stream
+    // was most likely opened in the middle of it
+    uint64_t skipped = 0;
+    // frames longer than the buffer, which were dropped
+    uint64_t overruns = 0;
+};
+
+// same as nrf_crc16() in nrf_dongle.h, over a run of bytes
+inline uint16_t crc16(const uint8_t *bytes, size_t size) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < size; i++) {
+        crc ^= (uint16_t)bytes[i] << 8;
+        for (uint8_t b = 0; b < 8; b++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+// decode a COBS frame (without its zero) in place,
+// returns its decoded size, or SIZE_MAX if it is not valid COBS
+inline size_t cobs_decode(uint8_t *frame, size_t size) {
+    size_t read = 0;
+    size_t written = 0;
+    while (read < size) {
+        uint8_t code = frame[read++];
+        if (code == 0 || read + code - 1 > size) {
+            return SIZE_MAX;
+        }
+        // written stays behind read, so the bytes can move in place
+        memmove(&frame[written], &frame[read], code - 1);
+        written += code - 1;
+        read += code - 1;
+        // a run shorter than 254 ended at a zero, but the last one
+        if (code < 0xFF && read < size) {
+            frame[written++] = 0;
+        }
+    }
+    return written;
+}
+
+class Decoder {
+    public:
+        // the buffer holds at least one frame, records are a few bytes
+        // longer than the item, and reads go in whatever room is left
+        explicit Decoder(size_t capacity = 1 << 16) : buffer(capacity) {}
+
+        // only hand out records whose item is size bytes, 0 (default) any
+        void set_record_size(size_t size) {
+            this->record_size = size;
+        }
+
+        // read what the fd has into the buffer, and call on_record
+        // with each record it completes, returns what read() returned
+        template <typename F> ssize_t read_from(int fd, F on_record) {
+            ssize_t n = ::read(fd, &this->buffer[this->end], this->buffer.size() - this->end);
+            if (n > 0) {
+                this->commit((size_t)n, on_record);
+            }
+            return n;
+        }
+
+        // the same for bytes from elsewhere, written to space()
+        // (room() of them at most) before they are committed
+        uint8_t *space() {
+            return &this->buffer[this->end];
+        }
+
+        size_t room() const {
+            return this->buffer.size() - this->end;
+        }
+
+        template <typename F> void commit(size_t n, F on_record) {
+            this->counters.bytes += n;
+            size_t scan = this->end;
+            this->end += n;
+
+            uint8_t *zero;
+            while ((zero = (uint8_t *)memchr(&this->buffer[scan], 0, this->end - scan)) != nullptr) {
+                size_t at = zero - &this->buffer[0];
+                this->frame(&this->buffer[this->start], at - this->start, on_record);
+                this->start = at + 1;
+                scan = this->start;
+            }
+
+            // nothing left over, the next read starts at the front
+            if (this->start == this->end) {
+                this->start = 0;
+                this->end = 0;
+                return;
+            }
+
+            // the unfinished frame moves to the front once the buffer is full,
+            // one that fills all of it is dropped up to the next zero
+            if (this->end == this->buffer.size()) {
+                if (this->start == 0) {
+                    if (!this->dropping) {
+                        this->counters.overruns++;
+                    }
+                    this->dropping = true;
+                    this->end = 0;
+                    return;
+                }
+                memmove(&this->buffer[0], &this->buffer[this->start], this->end - this->start);
+                this->end -= this->start;
+                this->start = 0;
+            }
+        }
+
+        const Counters &get_counters() const {
+            return this->counters;
+        }
+
+    private:
+        std::vector<uint8_t> buffer;
+        // the unfinished frame is buffer[start, end)
+        size_t start = 0;
+        size_t end = 0;
+        size_t record_size = 0;
+        bool first = true;
+        bool dropping = false;
+        Counters counters;
+
+        template <typename F> void frame(uint8_t *bytes, size_t size, F on_record) {
+            bool first = this->first;
+            this->first = false;
+
+            // the rest of a frame that overran the buffer
+            if (this->dropping) {
+                this->dropping = false;
+                return;
+            }
+
+            Record record;
+            size_t decoded = cobs_decode(bytes, size);
+            bool valid = decoded != SIZE_MAX && decoded >= 7
+                && (this->record_size == 0 || decoded == this->record_size + 7);
+            bool checked = valid && crc16(bytes, decoded - 2) == (bytes[decoded - 2] | (uint16_t)bytes[decoded - 1] << 8);
+            if (!checked) {
+                if (first) {
+                    this->counters.skipped++;
+                } else if (!valid) {
+                    this->counters.bad_frames++;
+                } else {
+                    this->counters.bad_crc++;
+                }
+                return;
+            }
+
+            record.micros = (uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+            record.source = bytes[4];
+            record.data = &bytes[5];
+            record.size = decoded - 7;
+            this->counters.records++;
+            on_record(record);
+        }
+};
+
+// open a tty raw (no echo, no line editing or translation of any byte),
+// at baud if it is a real serial port (USB CDC ignores it),
+// returns the fd, or -1 with errno set
+inline int open_tty(const char *path, uint32_t baud = 115200) {
+    int fd = ::open(path, O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct termios tio;
+    if (tcgetattr(fd, &tio) != 0) {
+        int error = errno;
+        ::close(fd);
+        errno = error;
+        return -1;
+    }
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    // block until at least a byte is there
+    tio.c_cc[VMIN] = 1;
+    tio.c_cc[VTIME] = 0;
+
+    speed_t speed;
+    switch (baud) {
+        case 9600: speed = B9600; break;
+        case 19200: speed = B19200; break;
+        case 38400: speed = B38400; break;
+        case 57600: speed = B57600; break;
+        case 115200: speed = B115200; break;
+        case 230400: speed = B230400; break;
+        case 460800: speed = B460800; break;
+        case 921600: speed = B921600; break;
+        case 1000000: speed = B1000000; break;
+        case 2000000: speed = B2000000; break;
+        default:
+            ::close(fd);
+            errno = EINVAL;
+            return -1;
+    }
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+
+    if (tcsetattr(fd, TCSANOW, &tio) != 0) {
+        int error = errno;
+        ::close(fd);
+        errno = error;
+        return -1;
+    }
+    return fd;
+}
+
+} // namespace nrf_stream
+
+#endif // NRF_STREAM_H
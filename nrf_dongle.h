@@ -9,46 +9,71 @@
 // this library can either use the nrf24 or nrf52
 // to use the nrf24, define NRF24
 // to use the nrf52, define NRF52
-
-// if neither NRF_HOST or NRF_DONGLE is defined,
-// or neither NRF24 or NRF52 is defined,
-// or if both from each set are defined,
+// to use the simulated radio (needs threads, see nrf_sim.h), define NRF_SIM
+// any of them can be defined together
+
+// NRF_HOST or NRF_DONGLE, and the radio, pick what NRFDongle<TData, ...> is.
+// NRFLink<Role, Backend, TData, ...> names the role and radio itself,
+// e.g. NRFLink<NRFHostRole, NRF24Backend, TData, 8>, so one program can
+// hold a host and a dongle, or links on an nRF24, an nRF52 and the
+// simulated radio, and needs neither NRF_HOST nor NRF_DONGLE. every radio
+// it uses must still be defined, as their libraries are only included then
+
+// if none of NRF24, NRF52 or NRF_SIM is defined,
+// or both NRF_HOST and NRF_DONGLE are defined,
+// or NRFDongle would not know which radio to use,
 // throw a compile error
 
-#if !defined(NRF_HOST) && !defined(NRF_DONGLE)
-    #error "Either NRF_HOST or NRF_DONGLE must be defined before including nrf_dongle.h"
-#endif
-
-#if !defined(NRF24) && !defined(NRF52)
-    #error "Either NRF24 or NRF52 must be defined before including nrf_dongle.h"
+// the role a link is built for is chosen by the preprocessor,
+// see nrf_link.h, so a link carries no code for the other one.
+// the radio is a template parameter, what differs between the radios
+// is in their backends (see NRF24Backend), and a link only
+// instantiates the one it is on.
+// to build the two ends of a link with different settings (e.g. only the
+// host numbering its packets) in the same program, build them in separate
+// translation units and define NRF_DONGLE_NAMESPACE to a different name
+// in each, so that their classes do not collide at link time
+
+#if !defined(NRF24) && !defined(NRF52) && !defined(NRF_SIM)
+    #error "One of NRF24, NRF52 or NRF_SIM must be defined before including nrf_dongle.h"
 #endif
 
 #if defined(NRF_HOST) && defined(NRF_DONGLE)
-    #error "Only one of NRF_HOST or NRF_DONGLE can be defined before including nrf_dongle.h"
+    #error "Only one of NRF_HOST or NRF_DONGLE can be defined before including nrf_dongle.h, use NRFLink for both"
 #endif
 
-#if defined(NRF24) && defined(NRF52)
-    #error "Only one of NRF24 or NRF52 can be defined before including nrf_dongle.h"
+#if (defined(NRF_HOST) || defined(NRF_DONGLE)) && defined(NRF24) + defined(NRF52) + defined(NRF_SIM) > 1
+    #error "NRFDongle needs one radio, use NRFLink with several radios defined"
 #endif
 
 #ifdef NRF24
     #include <SPI.h>
     // https://github.com/nRF24/RF24
     #include <RF24.h>
-    typedef RF24 Radio;
 #endif // NRF24
 
 #ifdef NRF52
     // https://github.com/TMRh20/nrf_to_nrf/
     #include "nrf_to_nrf.h"
-    typedef nrf_to_nrf Radio;
 #endif // NRF52
 
-// https://github.com/rlogiacco/CircularBuffer/
-#include <CircularBuffer.hpp>
+#if defined(NRF24) || defined(NRF52)
+    // https://github.com/rlogiacco/CircularBuffer/
+    #include <CircularBuffer.hpp>
+
+    // https://github.com/pfeerick/elapsedMillis
+    #include <elapsedMillis.h>
+#endif // NRF24 || NRF52
 
-// https://github.com/pfeerick/elapsedMillis
-#include <elapsedMillis.h>
+#ifdef NRF_SIM
+    // simulated radio, without a real one it also provides
+    // millis(), elapsedMillis, CircularBuffer and Print
+    #include "nrf_sim.h"
+#endif // NRF_SIM
+
+#ifdef NRF_DONGLE_NAMESPACE
+namespace NRF_DONGLE_NAMESPACE {
+#endif // NRF_DONGLE_NAMESPACE
 
 // pairing address, CANNOT be 0
 // only 40 bits are used, as addresses are only 5 bytes
@@ -57,608 +82,1810 @@ const uint64_t _PAIR_ADDRESS_ = 1;
 // pairing channel
 const uint8_t _PAIR_CHANNEL_ = 0;
 
-// Packet, wraps TData with a ping flag
-template <typename TData> struct Packet {
-    TData data;
-    bool ping = false;
+// define NRF_MAX_HOSTS on the dongle to serve up to 5 hosts at once,
+// each host gets its own reading pipe (1-5) on one common channel
+#ifndef NRF_MAX_HOSTS
+    #define NRF_MAX_HOSTS 1
+#endif // NRF_MAX_HOSTS
+
+#if NRF_MAX_HOSTS < 1 || NRF_MAX_HOSTS > 5
+    #error "NRF_MAX_HOSTS must be between 1 and 5"
+#endif
+
+// define NRF_IRQ on the dongle to receive from an interrupt, irq() moves
+// every packet out of the radio into a ring of NRF_IRQ_FRAMES packets,
+// which update() and read() then handle in the main context. call irq():
+//     nRF24: from the IRQ pin's falling edge interrupt, and call
+//            SPI.usingInterrupt() on it so the library's SPI calls mask it
+//     nRF52: from the RADIO interrupt
+//     sim:   attach it with SimRadio::attachInterrupt()
+// a host in the same program (see NRFLink) is built without it
+#ifdef NRF_IRQ
+    #ifdef NRF_HOST
+        #error "NRF_IRQ is only used by the dongle"
+    #endif
+
+    #ifndef NRF_IRQ_FRAMES
+        #define NRF_IRQ_FRAMES 8
+    #endif // NRF_IRQ_FRAMES
+#endif // NRF_IRQ
+
+// define NRF_STATS to count what the link does and time update(),
+// see get_stats(). without it nothing is counted or timed,
+// the counters take no memory and get_stats() returns all zeros
+#ifdef NRF_STATS
+    #define NRF_STATS_ADD(counter, n) (this->stats.counter += (n))
+#else
+    #define NRF_STATS_ADD(counter, n) ((void)0)
+#endif // NRF_STATS
+
+// the host's send queue has a second, small lane of NRF_PRIORITY_ITEMS
+// for latency-critical items, which go out ahead of everything else
+#ifndef NRF_PRIORITY_ITEMS
+    #define NRF_PRIORITY_ITEMS 4
+#endif // NRF_PRIORITY_ITEMS
+
+// what a full queue does with a new item, see set_overflow_policy()
+//     _QUEUE_DROP_OLDEST_: the oldest item makes room for it (default)
+//     _QUEUE_DROP_NEWEST_: the new item is dropped
+//     _QUEUE_REJECT_:      the new item is dropped and send() returns false
+const uint8_t _QUEUE_DROP_OLDEST_ = 0;
+const uint8_t _QUEUE_DROP_NEWEST_ = 1;
+const uint8_t _QUEUE_REJECT_ = 2;
+
+// while the dongle has room for another host, or a host has not finished
+// pairing, it spends _PAIR_WINDOW_MILLIS_ on the pairing channel
+// every _PAIR_WINDOW_INTERVAL_MILLIS_, hosts keep retrying until then
+const uint8_t _PAIR_WINDOW_MILLIS_ = 5;
+const uint8_t _PAIR_WINDOW_INTERVAL_MILLIS_ = 50;
+
+// a host that is not paired sends its next pairing packet at once
+// while the dongle answers without accepting it yet, up to
+// _PAIR_QUICK_TRIES_ times, otherwise it waits a random time of up to
+// _PAIR_BACKOFF_MIN_MILLIS_, a limit that doubles with every such try
+// up to _PAIR_BACKOFF_MAX_MILLIS_, so hosts that boot together spread out
+const uint8_t _PAIR_QUICK_TRIES_ = 4;
+const uint8_t _PAIR_BACKOFF_MIN_MILLIS_ = 2;
+const uint8_t _PAIR_BACKOFF_MAX_MILLIS_ = 64;
+
+// a host that loses the dongle looks for it on the data channel for
+// _RECONNECT_GRACE_MILLIS_ (see set_reconnect_grace()), waiting from
+// _RECONNECT_BACKOFF_MIN_MILLIS_ up to _RECONNECT_BACKOFF_MAX_MILLIS_
+// between tries, before it pairs again
+const uint16_t _RECONNECT_GRACE_MILLIS_ = 500;
+const uint8_t _RECONNECT_BACKOFF_MIN_MILLIS_ = 2;
+const uint8_t _RECONNECT_BACKOFF_MAX_MILLIS_ = 64;
+
+// a host with a wake interval (see set_wake_interval()) only sends while
+// the dongle listens: for _WAKE_WINDOW_MILLIS_ after each frame it heard,
+// and in windows as long every wake interval after the last one.
+// the host starts packets in the first _WAKE_START_MILLIS_ of a window,
+// the rest is for retries, and for the ACKs the dongle heard as sent
+// but the host did not, which start its windows later than the dongle's.
+// a duty-cycling dongle (see set_duty_cycle()) powers its radio down
+// in between, and up again _WAKE_GUARD_MILLIS_ before each window,
+// which covers the 5ms RF24 waits in powerUp()
+const uint8_t _WAKE_WINDOW_MILLIS_ = 8;
+const uint8_t _WAKE_START_MILLIS_ = 2;
+const uint8_t _WAKE_GUARD_MILLIS_ = 6;
+
+// the packet a non-blocking host has in flight, see set_update_budget()
+const uint8_t _FRAME_NONE_ = 0;
+const uint8_t _FRAME_DATA_ = 1;
+const uint8_t _FRAME_PING_ = 2;
+const uint8_t _FRAME_PAIR_ = 3;
+// a ping looking for a lost dongle
+const uint8_t _FRAME_PROBE_ = 4;
+// a ping of the adaptive link's recovery, see recover()
+const uint8_t _FRAME_RECOVER_ = 5;
+
+// dongle host slots
+const uint8_t _HOST_FREE_ = 0;
+const uint8_t _HOST_PENDING_ = 1;
+const uint8_t _HOST_PAIRED_ = 2;
+
+// everything on air is built byte by byte, multi-byte fields little endian,
+// so that hosts and dongles built by different compilers
+// (e.g. an nRF52 host and an RP2040 + nRF24 dongle) agree on every byte
+
+// write / read the low bytes of value, little endian
+inline void nrf_write_le(uint8_t *buf, uint64_t value, uint8_t bytes) {
+    for (uint8_t i = 0; i < bytes; i++) {
+        buf[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+inline uint64_t nrf_read_le(const uint8_t *buf, uint8_t bytes) {
+    uint64_t value = 0;
+    for (uint8_t i = 0; i < bytes; i++) {
+        value |= (uint64_t)buf[i] << (8 * i);
+    }
+    return value;
+}
+
+// mix the bits of value (splitmix64's finalizer), every bit of the result
+// depends on every bit of value, so ids that differ in any bit, even only
+// in the last, give results that differ all over
+inline uint64_t nrf_mix64(uint64_t value) {
+    value ^= value >> 30;
+    value *= 0xBF58476D1CE4E5B9ULL;
+    value ^= value >> 27;
+    value *= 0x94D049BB133111EBULL;
+    value ^= value >> 31;
+    return value;
+}
+
+// data rates and PA levels, numbered the same by RF24, nrf_to_nrf and the sim
+const uint8_t _RATE_1MBPS_ = 0;
+const uint8_t _RATE_2MBPS_ = 1;
+const uint8_t _RATE_250KBPS_ = 2;
+const uint8_t _PA_MAX_ = 3;
+
+inline uint8_t nrf_rate_rank(uint8_t rate) {
+    return rate == _RATE_250KBPS_ ? 0 : (rate == _RATE_1MBPS_ ? 1 : 2);
+}
+
+inline uint8_t nrf_rate_at_rank(uint8_t rank) {
+    return rank == 0 ? _RATE_250KBPS_ : (rank == 1 ? _RATE_1MBPS_ : _RATE_2MBPS_);
+}
+
+// microseconds a payload of size bytes takes on air: preamble, address,
+// 9 bit packet control field and CRC around it
+inline uint16_t nrf_air_micros(uint8_t size, uint8_t rate) {
+    uint16_t bits = 8 * (1 + 5 + size + 2) + 9;
+    if (rate == _RATE_2MBPS_) {
+        return bits / 2;
+    }
+    if (rate == _RATE_250KBPS_) {
+        return bits * 4;
+    }
+    return bits;
+}
+
+// the adaptive link looks at the retransmits of _ADAPT_WINDOW_ packets at a time
+const uint8_t _ADAPT_WINDOW_ = 16;
+// clean windows in a row before it tries a faster data rate,
+// doubled (up to the max) every time it has to step back down
+const uint8_t _ADAPT_HOLDOFF_MIN_ = 4;
+const uint8_t _ADAPT_HOLDOFF_MAX_ = 64;
+
+// packet types, stored in the top two bits of the packet header
+const uint8_t _PACKET_DATA_ = 0;
+const uint8_t _PACKET_PING_ = 1;
+const uint8_t _PACKET_CONTROL_ = 2;
+// a piece of a TData too large for one packet: the item count bits number
+// the message (mod 32), and a byte after the header gives the fragment's
+// index in it. the dongle puts the fragments together in its buffer and
+// drops a message whose fragments do not all arrive in order
+const uint8_t _PACKET_FRAGMENT_ = 3;
+
+// control packets carry their code in the item count bits,
+// followed by one value byte
+const uint8_t _CONTROL_DATA_RATE_ = 1;
+const uint8_t _CONTROL_CHANNEL_ = 2;
+
+// data channels are 1 to _CHANNEL_COUNT_, scanned with the radio's
+// received power detector, _SCAN_SAMPLES_ times each, listening for
+// _RPD_LISTEN_MICROS_ each time: startListening() returns at once, the
+// radio settles for 130us and the detector needs 40us more after that
+const uint8_t _CHANNEL_COUNT_ = 73;
+const uint8_t _SCAN_SAMPLES_ = 4;
+const uint8_t _RPD_LISTEN_MICROS_ = 170;
+// a migrating host compares its channel with _MIGRATE_CANDIDATES_ - 1
+// others spread over the band, at most once every _MIGRATE_HOLDOFF_ windows
+const uint8_t _MIGRATE_CANDIDATES_ = 9;
+const uint8_t _MIGRATE_STEP_ = 8;
+const uint8_t _MIGRATE_HOLDOFF_ = 16;
+
+// define NRF_PACKET_SEQUENCE on the host to number every packet it sends,
+// this costs one byte per packet, dongles accept packets either way.
+// data packets take consecutive numbers, the dongle drops repeats of them
+// and counts the ones that never arrived (see get_missed_packets()),
+// pings and control packets carry the oldest number the host still sends.
+// it also allows the reliable mode, see set_reliable()
+#ifdef NRF_PACKET_SEQUENCE
+    const bool _PACKET_SEQUENCE_ = true;
+#else
+    const bool _PACKET_SEQUENCE_ = false;
+#endif // NRF_PACKET_SEQUENCE
+
+// define NRF_PACKET_TIMESTAMP on the host and the dongle (it changes the
+// packet layout, like TData) to stamp every packet with the host's micros(),
+// this costs four bytes per packet. a data packet carries the time its
+// oldest item was given to send(), pings and control packets the time they
+// were sent and pings half the host's shortest ping round trip, from which
+// the dongle estimates the offset between the clocks, see get_latency()
+#ifdef NRF_PACKET_TIMESTAMP
+    const uint8_t _PACKET_TIMESTAMP_SIZE_ = 4;
+#else
+    const uint8_t _PACKET_TIMESTAMP_SIZE_ = 0;
+#endif // NRF_PACKET_TIMESTAMP
+
+// the dongle takes the clock offset as the smallest one packets showed
+// over the last two windows of _CLOCK_WINDOW_MILLIS_, so it follows drift
+const uint16_t _CLOCK_WINDOW_MILLIS_ = 1000;
+
+// buckets of the latency and jitter histograms, see NRFLatency,
+// bucket i counts values below 2^(i + _LATENCY_SHIFT_) microseconds
+// and the last one everything above
+const uint8_t _LATENCY_BUCKETS_ = 16;
+const uint8_t _LATENCY_SHIFT_ = 7;
+
+// a reliable host keeps up to _RELIABLE_WINDOW_ data packets until they are
+// acknowledged, the 3 a burst can have in the TX FIFO and the one being queued
+const uint8_t _RELIABLE_WINDOW_ = 4;
+
+// NRFSerialSink gathers records in a buffer of NRF_SINK_BUFFER bytes,
+// and writes it once it is full or its oldest record has waited
+// _SINK_FLUSH_MILLIS_ (see set_flush_interval())
+#ifndef NRF_SINK_BUFFER
+    #define NRF_SINK_BUFFER 256
+#endif // NRF_SINK_BUFFER
+
+const uint8_t _SINK_FLUSH_MILLIS_ = 10;
+
+// CRC-16/CCITT-FALSE (polynomial 0x1021, starting from 0xFFFF)
+// of the bytes so far, updated with one more byte
+inline uint16_t nrf_crc16(uint16_t crc, uint8_t byte) {
+    crc ^= (uint16_t)byte << 8;
+    for (uint8_t i = 0; i < 8; i++) {
+        crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+    return crc;
+}
+
+// sizes and positions in a list of message types, see NRFMessage
+template <typename... Types> struct NRFTypes;
+
+template <> struct NRFTypes<> {
+    static constexpr size_t max_size = 0;
+    static constexpr size_t min_size = SIZE_MAX;
+
+    static uint8_t size_at(uint8_t) {
+        return 0;
+    }
 };
 
-// Pairing Packet, contains the unique_id of the host,
-// the program_id, which must match the program_id of the dongle,
-// and the ping interval in milliseconds
-struct PairingPacket {
-    uint64_t unique_id;
-    uint64_t program_id;
-    uint16_t ping_interval_millis;
+template <typename T, typename... Rest> struct NRFTypes<T, Rest...> {
+    static constexpr size_t max_size = sizeof(T) > NRFTypes<Rest...>::max_size ? sizeof(T) : NRFTypes<Rest...>::max_size;
+    static constexpr size_t min_size = sizeof(T) < NRFTypes<Rest...>::min_size ? sizeof(T) : NRFTypes<Rest...>::min_size;
+
+    static uint8_t size_at(uint8_t index) {
+        return index == 0 ? sizeof(T) : NRFTypes<Rest...>::size_at(index - 1);
+    }
 };
 
-template <typename TData, uint8_t max_packets> class NRFDongle {
-    public:
-        // take in a reference to the radio, a unique identifier for this radio
-        // the ping interval in milliseconds,
-        // pairing timeout in milliseconds (0 for no timeout),
-        // and settings for the radio:
-        //     data rate, power level,
-        //     retry delay (x+1)*250us [x = 0-15]
-        //     number of retries [0-15]
-        #ifdef NRF24
-            NRFDongle(
-                        Radio &radio,
-                        uint64_t unique_id, // unused for dongle
-                        uint64_t program_id, // host and dongle must match
-                        uint16_t ping_interval_millis, // unused for dongle
-                        uint32_t pair_timeout_millis,
-                        uint8_t data_rate,
-                        uint8_t power_level,
-                        uint8_t retry_delay = 5, // (5+1)*250us = 1.5ms
-                        uint8_t retry_count = 15,
-                        uint8_t ce_pin = 29,
-                        uint8_t csn_pin = 5,
-                        uint8_t rx_pin = 4,
-                        uint8_t sck_pin = 2,
-                        uint8_t tx_pin = 3
-                    );
-        #endif // NRF24
-        #ifdef NRF52
-            NRFDongle(
-                        Radio &radio,
-                        uint64_t unique_id, // unused for dongle
-                        uint64_t program_id, // host and dongle must match
-                        uint16_t ping_interval_millis, // unused for dongle
-                        uint32_t pair_timeout_millis,
-                        uint8_t data_rate,
-                        uint8_t power_level,
-                        uint8_t retry_delay = 5, // (5+1)*250us = 1.5ms
-                        uint8_t retry_count = 15
-                    );
-        #endif // NRF52
+// position of T in Types
+template <typename T, typename... Types> struct NRFTypeIndex;
 
-        void begin();
-        void update();
-        void end();
-        bool unpair();
-        bool is_paired();
-        bool is_enabled();
-        uint64_t get_address();
-        uint64_t get_unique_id();
-        uint8_t get_channel();
-        uint64_t get_program_id();
-        void set_unique_id(uint64_t unique_id);
+template <typename T> struct NRFTypeIndex<T> {
+    static_assert(sizeof(T) == 0, "the type is not one of the NRFMessage's types");
+    static constexpr uint8_t value = 0;
+};
+
+template <typename T, typename... Rest> struct NRFTypeIndex<T, T, Rest...> {
+    static constexpr uint8_t value = 0;
+};
+
+template <typename T, typename U, typename... Rest> struct NRFTypeIndex<T, U, Rest...> {
+    static constexpr uint8_t value = 1 + NRFTypeIndex<T, Rest...>::value;
+};
 
-        // method for whether or not there is data in the buffer
-        bool has_data();
+// NRFMessage, a TData that is any one of several message types, e.g. a
+// frequent sample and a rare status report from the same host, so one
+// link carries them all: NRFLink<..., NRFMessage<Sample, Status>, 16>.
+// give send() any of the types, and read messages on the dongle with
+// is<T>() / get(T &), or hand them to an NRFHandlers.
+// on air a data packet carries messages of one type, its tag in a byte
+// after the header, and only as many bytes per message as its type has,
+// so a small message does not pay for the largest one. in the queues and
+// buffers a message takes as much room as the largest type, plus the tag
+template <typename... Types> struct NRFMessage {
+    static_assert(sizeof...(Types) > 0 && sizeof...(Types) < 256, "NRFMessage takes 1 to 255 types");
+
+    static constexpr uint8_t type_count = sizeof...(Types);
+    static constexpr size_t max_size = NRFTypes<Types...>::max_size;
+    static constexpr size_t min_size = NRFTypes<Types...>::min_size;
+
+    // which of the types it is, by position, and its bytes, the rest zeros
+    uint8_t tag;
+    uint8_t payload[max_size];
+
+    NRFMessage() {
+        this->clear(0);
+    }
 
-        Radio &get_radio();
+    template <typename T> NRFMessage(const T &message) {
+        this->set(message);
+    }
 
-        #ifdef NRF_HOST
-            bool send(TData data, bool send_now = false);
+    template <typename T> static constexpr uint8_t tag_of() {
+        return NRFTypeIndex<T, Types...>::value;
+    }
 
-            bool ping();
-        #endif // NRF_HOST
+    // bytes of the type with a tag
+    static uint8_t size_of(uint8_t tag) {
+        return NRFTypes<Types...>::size_at(tag);
+    }
 
-        #ifdef NRF_DONGLE
-            bool read(TData &data, bool pop = true);
-        #endif // NRF_DONGLE
+    template <typename T> void set(const T &message) {
+        this->clear(tag_of<T>());
+        memcpy(this->payload, &message, sizeof(T));
+    }
 
-    private:
-        Radio &radio;
-        bool enabled = false;
-        bool paired = false;
-        uint64_t address;
-        uint64_t unique_id;
-        uint64_t program_id;
-        uint8_t channel;
-        uint8_t data_rate;
-        uint8_t power_level;
-        uint8_t retry_delay;
-        uint8_t retry_count;
-        CircularBuffer<TData, max_packets> buffer;
-        elapsedMillis ping_timer;
-        elapsedMillis pair_timer;
-        uint16_t ping_interval_millis;
-        uint32_t pair_timeout_millis;
-
-        #ifdef NRF24
-            uint8_t ce_pin;
-            uint8_t csn_pin;
-            uint8_t rx_pin;
-            uint8_t sck_pin;
-            uint8_t tx_pin;
-        #endif // NRF24
-
-        bool try_pair();
+    template <typename T> bool is() const {
+        return this->tag == tag_of<T>();
+    }
+
+    // copy the message out, returns false if it is another type
+    template <typename T> bool get(T &message) const {
+        if (!this->is<T>()) {
+            return false;
+        }
+        memcpy(&message, this->payload, sizeof(T));
+        return true;
+    }
+
+    uint8_t size() const {
+        return size_of(this->tag);
+    }
+
+    // an empty message of a type, for its bytes to be filled in
+    void clear(uint8_t tag) {
+        this->tag = tag;
+        memset(this->payload, 0, max_size);
+    }
 };
 
-// Implementation
+// how Packet puts an item on air, its bytes as they are in memory,
+// or for an NRFMessage the bytes of its type, under a tag
+template <typename T> struct NRFItem {
+    static constexpr bool typed = false;
+    static constexpr size_t max_size = sizeof(T);
+    static constexpr size_t min_size = sizeof(T);
+    static constexpr uint8_t type_count = 1;
 
-// Constructor
-template <typename TData, uint8_t max_packets> NRFDongle<TData, max_packets>::NRFDongle(Radio &radio, uint64_t unique_id, uint64_t program_id, uint16_t ping_interval_millis, uint32_t pair_timeout_millis, uint8_t data_rate, uint8_t power_level, uint8_t retry_delay, uint8_t retry_count
-    #ifdef NRF24
-        ,
-        uint8_t ce_pin,
-        uint8_t csn_pin,
-        uint8_t rx_pin,
-        uint8_t sck_pin,
-        uint8_t tx_pin
-    #endif // NRF24
-        ) : radio(radio) {
-
-    // US law restricts the use of the 2.4 GHz band
-    // specifically, frequencies between 2.4-2.473 GHz
-    // are generally allowed.
-    // This corresponds to nRF channels 0-73
-    // (https://github.com/mysensors/MySensors/blob/ee91d5da38a1435cb4b55476447e763f52540c3c/MyConfig.h#L455)
-    // 0 -> 2400 MHz
-    // 1 -> 2401 MHz
-    // n -> 2400 + n MHz
-    // Channel 0 is reserved for pairing (not yet implemented)
-    // https://en.wikipedia.org/wiki/List_of_WLAN_channels
-
-    // the channel will be determined by the unique_id of
-    // the host, specifically
-    // channel = (unique_id % 73) + 1
-    // so the channel will be between 1 and 73
-    // since 0 is reserved for pairing
-
-    // if this is the host, the unique_id will be the address
-    // if this is the dongle, the unique_id is unused
-    //     and the address will later be the address of the host
-
-    // set enabled in the constructor to prevent powerup sequence on first begin
-    this->enabled = true;
-
-    // for now, since we need to pair, the addres is _PAIR_ADDRESS_
-    this->address = _PAIR_ADDRESS_;
-    this->paired = false;
-
-    // set the unique_id, which will be used later
-    this->unique_id = unique_id;
-
-    // set the program_id, which must match the program_id of the host
-    this->program_id = program_id;
-
-    // set the channel to the pairing channel
-    this->channel = _PAIR_CHANNEL_;
-
-    // set the ping interval
-    this->ping_interval_millis = ping_interval_millis;
-
-    // set the pair timeout
-    this->pair_timeout_millis = pair_timeout_millis;
-
-    // save radio settings
-    this->data_rate = data_rate;
-    this->power_level = power_level;
-    this->retry_delay = retry_delay;
-    this->retry_count = retry_count;
-
-    #ifdef NRF24
-        this->ce_pin = ce_pin;
-        this->csn_pin = csn_pin;
-        this->rx_pin = rx_pin;
-        this->sck_pin = sck_pin;
-        this->tx_pin = tx_pin;
-    #endif // NRF24
-}
+    static uint8_t tag(const T &) {
+        return 0;
+    }
 
-// Begin
-template <typename TData, uint8_t max_packets> void NRFDongle<TData, max_packets>::begin() {
+    static size_t size(uint8_t) {
+        return sizeof(T);
+    }
 
-    if (!this->enabled){
-        this->enabled = true;
-        this->radio.powerUp();
+    static const uint8_t *bytes(const T &item) {
+        return (const uint8_t *)&item;
     }
 
-    #ifdef NRF24
-        SPI.setRX(this->rx_pin);
-        SPI.setTX(this->tx_pin);
-        SPI.setSCK(this->sck_pin);
-        SPI.setCS(this->csn_pin);
-        SPI.begin(true);
+    static uint8_t *clear(T &item, uint8_t) {
+        return (uint8_t *)&item;
+    }
+};
 
-        this->radio.begin(&SPI, this->ce_pin, this->csn_pin);
-    #endif // NRF24
+template <typename... Types> struct NRFItem<NRFMessage<Types...>> {
+    typedef NRFMessage<Types...> T;
+    static constexpr bool typed = true;
+    static constexpr size_t max_size = T::max_size;
+    static constexpr size_t min_size = T::min_size;
+    static constexpr uint8_t type_count = T::type_count;
 
-    #ifdef NRF52
-        this->radio.begin();
-    #endif // NRF52
+    static uint8_t tag(const T &item) {
+        return item.tag;
+    }
 
-    this->channel = _PAIR_CHANNEL_;
-    this->address = _PAIR_ADDRESS_;
-    this->paired = false;
+    static size_t size(uint8_t tag) {
+        return T::size_of(tag);
+    }
 
-    // set the channel
-    this->radio.setChannel(channel);
+    static const uint8_t *bytes(const T &item) {
+        return item.payload;
+    }
 
-    // apply settings
-    #ifdef NRF24
-        this->radio.setDataRate((rf24_datarate_e)this->data_rate);
-        this->radio.setPALevel((rf24_pa_dbm_e)this->power_level);
-    #endif // NRF24
-    #ifdef NRF52
-        this->radio.setDataRate(this->data_rate);
-        this->radio.setPALevel(this->power_level);
-    #endif // NRF52
-    this->radio.setRetries(this->retry_delay, this->retry_count);
-
-    // set transmission size to the size of the pairing packet during pairing
-    // later, we will set the payload size to the size of the data packet
-    this->radio.setPayloadSize(sizeof(PairingPacket));
-
-    // host opens writing pipe
-    // dongle opens reading pipe
-    #ifdef NRF_HOST
-        this->radio.openWritingPipe(this->address);
-    #endif // NRF_HOST
-    #ifdef NRF_DONGLE
-        this->radio.openReadingPipe(1, this->address);
-    #endif // NRF_DONGLE
+    static uint8_t *clear(T &item, uint8_t tag) {
+        item.clear(tag);
+        return item.payload;
+    }
+};
 
-    // start listening on the dongle
-    #ifdef NRF_HOST
-        this->radio.stopListening();
-    #endif // NRF_HOST
-    #ifdef NRF_DONGLE
-        this->radio.startListening();
-    #endif // NRF_DONGLE
+// Packet, the frame on air:
+//     header byte: bits 7-6 type, bit 5 sequence byte follows, bits 4-0 item count
+//     sequence byte, if the sequence bit is set
+//     timestamp (4 bytes, little endian), if NRF_PACKET_TIMESTAMP is defined
+//     count TData
+// as many TData as fit in the 32 byte payload share one packet,
+// so the preamble, address, CRC and ACK are paid once for all of them
+// a TData too large for one payload is split into fragments instead,
+// sent one after the other, see _PACKET_FRAGMENT_
+// a data packet with no item count carries delta encoded items instead:
+//     header byte, sequence byte
+//     item count byte
+//     per item, a bitmap of the bytes that differ from the item before it
+//     (bit i % 8 of byte i / 8 for byte i), then those bytes in order
+// a data packet of an NRFMessage carries messages of one type:
+//     header byte, sequence byte, timestamp
+//     tag byte, the position of their type in the NRFMessage
+//     count messages, each as many bytes as the type has
+template <typename TData> struct Packet {
+    static constexpr uint8_t header_size = (_PACKET_SEQUENCE_ ? 2 : 1) + _PACKET_TIMESTAMP_SIZE_;
 
-    // start timers
-    this->ping_timer = 0;
-    this->pair_timer = 0;
-}
+    typedef NRFItem<TData> Item;
+    static constexpr bool typed = Item::typed;
+    static constexpr uint8_t tag_size = typed ? 1 : 0;
 
-// Update
-template <typename TData, uint8_t max_packets> void NRFDongle<TData, max_packets>::update() {
+    static_assert(!typed || header_size + 1 + Item::max_size <= 32, "every type of an NRFMessage plus the packet header and tag must fit in the 32 byte payload");
 
-    if (!this->enabled){
-        return;
+    // fragmentation is sized for the longest header, with the sequence byte,
+    // so a host that numbers its packets and a dongle that does not agree
+    // on which TData are fragmented and on where each fragment's bytes go
+    static constexpr uint8_t fragment_header_size = 2 + _PACKET_TIMESTAMP_SIZE_;
+
+    // bytes of TData in each fragment, and the fragments it takes,
+    // the last one may be shorter
+    static constexpr uint8_t fragment_size() {
+        return 32 - fragment_header_size - 1;
     }
 
-    // if we are the host, we can send packets
-    #ifdef NRF_HOST
-        // if we are not paired, try to pair
-        if (!this->paired) {
-            this->paired = this->try_pair();
-
-            // if we are not paired, and the pair timeout has exceeded
-            // then power down the radio
-            // unless the timeout is disabled (pair_timeout_millis = 0)
-            if (this->pair_timeout_millis > 0 && !this->paired && this->pair_timer > this->pair_timeout_millis) {
-                this->end();
+    static constexpr size_t fragment_count() {
+        return (sizeof(TData) + fragment_size() - 1) / fragment_size();
+    }
+
+    // an NRFMessage is never fragmented, each of its types fits
+    static constexpr bool fragmented = !typed && sizeof(TData) + fragment_header_size > 32;
+
+    static_assert(fragment_count() <= 256, "TData must fit in 256 fragments");
+
+    // bytes of a delta encoded item's bitmap, fragments are never delta encoded
+    static constexpr uint8_t bitmap_size = fragmented ? 0 : (sizeof(TData) + 7) / 8;
+
+    // the item count has 5 bits, a fragmented TData is one item per message,
+    // and as many NRFMessages as there are of its smallest type
+    static constexpr size_t item_room = 32 - header_size - tag_size;
+    static constexpr uint8_t max_items = fragmented ? 1 : (item_room / Item::min_size > 31 ? 31 : item_room / Item::min_size);
+
+    // payload size of a packet carrying n items, the smallest that holds them,
+    // fragments can take the whole payload, as can NRFMessages of the
+    // largest type if it holds all n (a packet of smaller ones is shorter)
+    static constexpr uint8_t size(uint8_t n) {
+        return n == 0 ? header_size
+            : fragmented ? 32
+            : typed ? (header_size + tag_size + n * Item::max_size > 32 ? 32 : header_size + tag_size + n * Item::max_size)
+            : header_size + n * sizeof(TData);
+    }
+
+    uint8_t bytes[32];
+
+    // stamped with the current time, see set_timestamp()
+    void set_header(uint8_t type, uint8_t count, uint8_t sequence = 0) {
+        this->bytes[0] = (uint8_t)((type << 6) | (_PACKET_SEQUENCE_ ? 0x20 : 0) | (count & 0x1F));
+        if (_PACKET_SEQUENCE_) {
+            this->bytes[1] = sequence;
+        }
+        #ifdef NRF_PACKET_TIMESTAMP
+            this->set_timestamp(micros());
+        #endif // NRF_PACKET_TIMESTAMP
+    }
+
+    #ifdef NRF_PACKET_TIMESTAMP
+        void set_timestamp(uint32_t micros_sent) {
+            nrf_write_le(&this->bytes[header_size - _PACKET_TIMESTAMP_SIZE_], micros_sent, _PACKET_TIMESTAMP_SIZE_);
+        }
+
+        uint32_t timestamp() const {
+            return (uint32_t)nrf_read_le(&this->bytes[this->received_header_size() - _PACKET_TIMESTAMP_SIZE_], _PACKET_TIMESTAMP_SIZE_);
+        }
+    #endif // NRF_PACKET_TIMESTAMP
+
+    uint8_t type() const {
+        return this->bytes[0] >> 6;
+    }
+
+    uint8_t count() const {
+        return this->bytes[0] & 0x1F;
+    }
+
+    bool has_sequence() const {
+        return (this->bytes[0] & 0x20) != 0;
+    }
+
+    uint8_t sequence() const {
+        return this->has_sequence() ? this->bytes[1] : 0;
+    }
+
+    // header size of a received packet, the host may or may not number packets
+    uint8_t received_header_size() const {
+        return (this->has_sequence() ? 2 : 1) + _PACKET_TIMESTAMP_SIZE_;
+    }
+
+    // true if the items described by the header fit in len bytes
+    bool fits(uint8_t len) const {
+        uint8_t header = this->received_header_size();
+        if (typed && this->count() > 0) {
+            uint8_t tag = this->bytes[header];
+            return header + tag_size <= len && tag < Item::type_count && header + tag_size + this->count() * Item::size(tag) <= len;
+        }
+        return header + this->count() * sizeof(TData) <= len;
+    }
+
+    // true if data fits in a packet of capacity bytes after the first
+    // count items, a packet of NRFMessages only takes more of the same type
+    bool room_for(uint8_t count, const TData &data, uint8_t capacity) const {
+        uint8_t tag = Item::tag(data);
+        if (typed && count > 0 && this->bytes[header_size] != tag) {
+            return false;
+        }
+        return header_size + tag_size + (count + 1) * Item::size(tag) <= capacity;
+    }
+
+    bool is_delta() const {
+        return this->type() == _PACKET_DATA_ && this->count() == 0;
+    }
+
+    // payload size of a packet built by this side
+    uint8_t length() const {
+        if (this->is_delta()) {
+            uint8_t offset = header_size + 1;
+            for (uint8_t i = 0; i < this->bytes[header_size]; i++) {
+                uint8_t changed = 0;
+                for (uint8_t b = 0; b < bitmap_size; b++) {
+                    changed += __builtin_popcount(this->bytes[offset + b]);
+                }
+                offset += bitmap_size + changed;
             }
+            return offset;
         }
+        if (this->type() == _PACKET_FRAGMENT_) {
+            size_t offset = (size_t)this->bytes[header_size] * fragment_size();
+            size_t rest = sizeof(TData) - offset;
+            return header_size + 1 + (rest < fragment_size() ? rest : fragment_size());
+        }
+        if (typed && this->type() == _PACKET_DATA_) {
+            return header_size + tag_size + this->count() * Item::size(this->bytes[header_size]);
+        }
+        return size(this->count());
+    }
+
+    // items a packet built by this side completes, a fragment only the last
+    uint8_t items() const {
+        if (this->is_delta()) {
+            return this->bytes[header_size];
+        }
+        if (this->type() == _PACKET_FRAGMENT_) {
+            return this->bytes[header_size] == fragment_count() - 1 ? 1 : 0;
+        }
+        return this->count();
+    }
 
-        // if we are paired, we can send packets and ping
-        else {
+    // fragment index of message (5 bits) from data
+    void set_fragment(uint8_t message, uint8_t index, const TData &data, uint8_t sequence = 0) {
+        this->set_header(_PACKET_FRAGMENT_, message, sequence);
+        this->bytes[header_size] = index;
+        size_t offset = (size_t)index * fragment_size();
+        memcpy(&this->bytes[header_size + 1], (const uint8_t *)&data + offset, this->length() - header_size - 1);
+    }
+
+    uint8_t fragment_index() const {
+        return this->bytes[this->received_header_size()];
+    }
 
-            // if we have packets to send
-            if (!this->buffer.isEmpty()) {
-                // send the packet, and pop it
-                bool received = this->send(this->buffer.pop(), true);
+    // true if a received fragment is the last of its message
+    bool last_fragment() const {
+        return this->fragment_index() == fragment_count() - 1;
+    }
+
+    // copy a received fragment of len bytes into its place in data,
+    // returns false if it is not a fragment of TData
+    bool get_fragment(TData &data, uint8_t len) const {
+        uint8_t header = this->received_header_size();
+        uint8_t index = this->fragment_index();
+        if (len <= header + 1 || index >= fragment_count()) {
+            return false;
+        }
+        size_t offset = (size_t)index * fragment_size();
+        size_t rest = sizeof(TData) - offset;
+        size_t bytes = len - header - 1;
+        if (bytes != (rest < fragment_size() ? rest : fragment_size())) {
+            return false;
+        }
+        memcpy((uint8_t *)&data + offset, &this->bytes[header + 1], bytes);
+        return true;
+    }
+
+    // the items of a packet of NRFMessages are all of one type
+    void set(uint8_t index, const TData &data) {
+        uint8_t tag = Item::tag(data);
+        size_t size = Item::size(tag);
+        if (typed) {
+            this->bytes[header_size] = tag;
+        }
+        memcpy(&this->bytes[header_size + tag_size + index * size], Item::bytes(data), size);
+    }
+
+    void get(uint8_t index, TData &data) const {
+        uint8_t header = this->received_header_size();
+        uint8_t tag = typed ? this->bytes[header] : 0;
+        size_t size = Item::size(tag);
+        memcpy(Item::clear(data, tag), &this->bytes[header + tag_size + index * size], size);
+    }
+
+    // write data at offset as the bytes that differ from before,
+    // returns the offset after it, or 0 if it does not fit in the payload
+    uint8_t put_delta(uint8_t offset, const TData &data, const TData &before) {
+        const uint8_t *now = (const uint8_t *)&data;
+        const uint8_t *old = (const uint8_t *)&before;
+        uint8_t changed = 0;
+        for (size_t i = 0; i < sizeof(TData); i++) {
+            changed += now[i] != old[i];
+        }
+        if (offset + bitmap_size + changed > 32) {
+            return 0;
+        }
+
+        uint8_t *bitmap = &this->bytes[offset];
+        uint8_t at = offset + bitmap_size;
+        memset(bitmap, 0, bitmap_size);
+        for (size_t i = 0; i < sizeof(TData); i++) {
+            if (now[i] != old[i]) {
+                bitmap[i / 8] |= 1 << (i % 8);
+                this->bytes[at++] = now[i];
+            }
+        }
+        return at;
+    }
+
+    // apply the delta encoded item at offset to data, which holds the item
+    // before it, returns the offset after it, or 0 if it runs past len bytes
+    uint8_t get_delta(uint8_t offset, uint8_t len, TData &data) const {
+        if (offset + bitmap_size > len) {
+            return 0;
+        }
+
+        const uint8_t *bitmap = &this->bytes[offset];
+        uint8_t *out = (uint8_t *)&data;
+        uint8_t at = offset + bitmap_size;
+        for (size_t i = 0; i < sizeof(TData); i++) {
+            if (bitmap[i / 8] & (1 << (i % 8))) {
+                if (at >= len) {
+                    return 0;
+                }
+                out[i] = this->bytes[at++];
+            }
+        }
+        return at;
+    }
+};
+
+// NRFRing, the dongle's receive buffers and the lanes of the host's queue
+// a FIFO ring of size items that packets are unpacked into in place,
+// and that can be read in place (peek / consume) or in runs (read),
+// with the same methods as CircularBuffer for everything else
+// when full, a new item is handled by the overflow policy, starting at policy_
+// with any policy but _QUEUE_DROP_OLDEST_ the ring is safe for
+// one producer (e.g. an interrupt) and one consumer without locking:
+// the producer only moves tail, the consumer only moves head
+// (pop() and last() then belong to neither and must not be used)
+// it also keeps the most items it has held, to size it from real traffic
+template <typename T, uint8_t size_, uint8_t policy_ = _QUEUE_DROP_OLDEST_> class NRFRing {
+    static_assert(size_ > 0 && size_ < 255, "NRFRing holds 1 to 254 items");
+
+    public:
+        // slot the next item goes in, commit() it once written
+        T &reserve() {
+            return this->items[load(this->tail)];
+        }
 
-                // if the packet was not received, unpair and clear the buffer
-                if (!received) {
-                    this->unpair();
-                    this->buffer.clear();
-                } else {
-                    // reset the ping timer as there's no need to ping
-                    // if data was sent and received
-                    this->ping_timer = 0;
+        // returns false if an item was lost, the oldest or this one
+        bool commit() {
+            uint8_t tail = load(this->tail);
+            uint8_t next = wrap(tail + 1);
+            if (next == load(this->head)) {
+                if (this->policy != _QUEUE_DROP_OLDEST_) {
+                    return false;
                 }
+                store(this->head, wrap(next + 1));
+                store(this->tail, next);
+                return false;
+            }
+            store(this->tail, next);
 
+            uint8_t size = this->size();
+            if (size > this->high_water) {
+                this->high_water = size;
             }
+            return true;
+        }
+
+        bool push(const T &item) {
+            this->reserve() = item;
+            return this->commit();
+        }
+
+        // newest item
+        T pop() {
+            uint8_t tail = wrap(load(this->tail) + slots - 1);
+            store(this->tail, tail);
+            return this->items[tail];
+        }
 
-            // try to ping
-            // if data was just sent, then this will be skipped safely
-            if (!this->ping()) {
-                // if the ping was sent and not acknowledged, unpair
-                this->unpair();
-                this->buffer.clear();
+        // oldest item
+        T shift() {
+            uint8_t head = load(this->head);
+            T item = this->items[head];
+            store(this->head, wrap(head + 1));
+            return item;
+        }
+
+        const T &first() const {
+            return this->items[load(this->head)];
+        }
+
+        // index-th oldest item
+        const T &operator [] (uint8_t index) const {
+            return this->items[wrap(load(this->head) + index)];
+        }
+
+        const T &last() const {
+            return this->items[wrap(load(this->tail) + slots - 1)];
+        }
+
+        // oldest items, in place, returns how many are contiguous
+        size_t peek(const T *&items) const {
+            uint8_t head = load(this->head);
+            uint8_t tail = load(this->tail);
+            items = &this->items[head];
+            return tail >= head ? tail - head : slots - head;
+        }
+
+        // drop the n oldest items
+        void consume(size_t n) {
+            if (n > this->size()) {
+                n = this->size();
             }
+            store(this->head, wrap(load(this->head) + n));
         }
-    #endif // NRF_HOST
 
-    // if we are the dongle, we can receive packets
-    #ifdef NRF_DONGLE
-        // if we are not paired, try to pair
-        if (!this->paired) {
-            this->paired = this->try_pair();
-
-            // if we are not paired, and the pair timeout has exceeded
-            // then power down the radio
-            // unless the timeout is disabled (pair_timeout_millis = 0)
-            if (this->pair_timeout_millis > 0 && !this->paired && this->pair_timer > this->pair_timeout_millis) {
-                this->end();
+        // copy and drop up to n of the oldest items, returns how many
+        size_t read(T *out, size_t n) {
+            size_t copied = 0;
+            // at most two runs, before and after the end of the ring
+            while (copied < n) {
+                const T *items;
+                size_t run = this->peek(items);
+                if (run == 0) {
+                    break;
+                }
+                if (run > n - copied) {
+                    run = n - copied;
+                }
+                memcpy(&out[copied], items, run * sizeof(T));
+                this->consume(run);
+                copied += run;
             }
-        } else if (this->ping_timer > 2 * this->ping_interval_millis) {
-            // if we are paired, but the ping timer has exceeded
-            // twice ping_interval_millis, unpair
-            this->unpair();
-        } else if (this->radio.available()) {
-            // if we are paired, we can receive packets
-            // if we have a packet
-
-            // create a packet
-            Packet<TData> packet;
-            // read the packet
-            this->radio.read(&packet, sizeof(Packet<TData>));
-
-            // push the packet if it is not a ping packet
-            if (!packet.ping) {
-                this->buffer.push(packet.data);
+            return copied;
+        }
+
+        uint8_t size() const {
+            return wrap(load(this->tail) + slots - load(this->head));
+        }
+
+        uint8_t capacity() const {
+            return size_;
+        }
+
+        bool isEmpty() const {
+            return load(this->head) == load(this->tail);
+        }
+
+        bool isFull() const {
+            return this->size() == size_;
+        }
+
+        // drops everything the producer has committed so far
+        void clear() {
+            store(this->head, load(this->tail));
+        }
+
+        void set_overflow_policy(uint8_t policy) {
+            this->policy = policy;
+        }
+
+        uint8_t get_overflow_policy() const {
+            return this->policy;
+        }
+
+        // most items held at once since the last reset
+        uint8_t high_water_mark() const {
+            return this->high_water;
+        }
+
+        void reset_high_water_mark() {
+            this->high_water = this->size();
+        }
+
+    private:
+        // one slot stays empty, so head == tail only when the ring is empty
+        static constexpr uint8_t slots = size_ + 1;
+
+        T items[slots];
+        uint8_t policy = policy_;
+        uint8_t high_water = 0;
+        // index of the oldest item, moved by the consumer
+        uint8_t head = 0;
+        // index after the newest item, moved by the producer
+        uint8_t tail = 0;
+
+        static uint8_t wrap(uint16_t index) {
+            return index % slots;
+        }
+
+        // the items are written before tail moves past them,
+        // and read before head moves past them
+        static uint8_t load(const uint8_t &index) {
+            return __atomic_load_n(&index, __ATOMIC_ACQUIRE);
+        }
+
+        static void store(uint8_t &index, uint8_t value) {
+            __atomic_store_n(&index, value, __ATOMIC_RELEASE);
+        }
+};
+
+// NRFQueue, the host's send queue
+// FIFO in two lanes, priority items are taken ahead of every bulk item,
+// each lane keeps its own order and overflows on its own
+template <typename T, uint8_t size_, uint8_t priority_size = NRF_PRIORITY_ITEMS> class NRFQueue {
+    public:
+        // returns false if an item was lost, see NRFRing::commit()
+        bool push(const T &item, bool priority = false) {
+            bool stored = priority ? this->priority_lane.push(item) : this->bulk_lane.push(item);
+
+            uint8_t size = this->size();
+            if (size > this->high_water) {
+                this->high_water = size;
             }
+            return stored;
+        }
 
-            // if we have successfully received a packet
-            // reset the ping timer
-            this->ping_timer = 0;
+        // oldest priority item, or oldest bulk item if there are none
+        T shift() {
+            if (!this->priority_lane.isEmpty()) {
+                return this->priority_lane.shift();
+            }
+            return this->bulk_lane.shift();
         }
-    #endif // NRF_DONGLE
-}
 
-// End
-template <typename TData, uint8_t max_packets> void NRFDongle<TData, max_packets>::end() {
-    if (this->enabled){
-        this->enabled = false;
-        this->radio.powerDown();
+        const T &first() const {
+            if (!this->priority_lane.isEmpty()) {
+                return this->priority_lane.first();
+            }
+            return this->bulk_lane.first();
+        }
+
+        uint8_t size() const {
+            return this->priority_lane.size() + this->bulk_lane.size();
+        }
+
+        bool isEmpty() const {
+            return this->priority_lane.isEmpty() && this->bulk_lane.isEmpty();
+        }
+
+        // items push() can still take without priority before one is lost
+        uint8_t room() const {
+            return size_ - this->bulk_lane.size();
+        }
+
+        void clear() {
+            this->priority_lane.clear();
+            this->bulk_lane.clear();
+        }
+
+        void set_overflow_policy(uint8_t policy) {
+            this->priority_lane.set_overflow_policy(policy);
+            this->bulk_lane.set_overflow_policy(policy);
+        }
+
+        uint8_t get_overflow_policy() const {
+            return this->bulk_lane.get_overflow_policy();
+        }
+
+        // most items held at once in both lanes since the last reset
+        uint8_t high_water_mark() const {
+            return this->high_water;
+        }
+
+        void reset_high_water_mark() {
+            this->high_water = this->size();
+        }
+
+    private:
+        NRFRing<T, priority_size> priority_lane;
+        NRFRing<T, size_> bulk_lane;
+        uint8_t high_water = 0;
+};
+
+// Pairing Packet, contains the unique_id of the host,
+// the program_id, which must match the program_id of the dongle,
+// the ping interval in milliseconds,
+// the payload size the host will use once paired,
+// the quietest data channel the host found (0 for none),
+// how long the host looks for a lost dongle before pairing again,
+// and its wake interval (0 for none)
+// on air it is 24 bytes: unique_id (8), program_id (8),
+// ping_interval_millis (2), payload_size (1), channel (1),
+// reconnect_grace_millis (2), wake_interval_millis (2)
+struct PairingPacket {
+    static constexpr uint8_t size = 24;
+
+    uint64_t unique_id;
+    uint64_t program_id;
+    uint16_t ping_interval_millis;
+    uint8_t payload_size;
+    uint8_t channel;
+    uint16_t reconnect_grace_millis;
+    uint16_t wake_interval_millis;
+
+    void encode(uint8_t *buf) const {
+        nrf_write_le(&buf[0], this->unique_id, 8);
+        nrf_write_le(&buf[8], this->program_id, 8);
+        nrf_write_le(&buf[16], this->ping_interval_millis, 2);
+        buf[18] = this->payload_size;
+        buf[19] = this->channel;
+        nrf_write_le(&buf[20], this->reconnect_grace_millis, 2);
+        nrf_write_le(&buf[22], this->wake_interval_millis, 2);
     }
-}
 
-// Unpair
-template <typename TData, uint8_t max_packets> bool NRFDongle<TData, max_packets>::unpair() {
-    if (!this->enabled){
-        return false;
+    void decode(const uint8_t *buf) {
+        this->unique_id = nrf_read_le(&buf[0], 8);
+        this->program_id = nrf_read_le(&buf[8], 8);
+        this->ping_interval_millis = (uint16_t)nrf_read_le(&buf[16], 2);
+        this->payload_size = buf[18];
+        this->channel = buf[19];
+        this->reconnect_grace_millis = (uint16_t)nrf_read_le(&buf[20], 2);
+        this->wake_interval_millis = (uint16_t)nrf_read_le(&buf[22], 2);
+    }
+};
+
+// Pairing Accept, the dongle's answer to a pairing packet,
+// sent on the ACK of the host's next pairing packet
+// it names the host it is for (several may be pairing at once),
+// and the address and channel the host must use
+// on air it is 14 bytes: unique_id (8), address (5), channel (1)
+struct PairingAccept {
+    static constexpr uint8_t size = 14;
+
+    uint64_t unique_id;
+    uint64_t address;
+    uint8_t channel;
+
+    void encode(uint8_t *buf) const {
+        nrf_write_le(&buf[0], this->unique_id, 8);
+        nrf_write_le(&buf[8], this->address, 5);
+        buf[13] = this->channel;
+    }
+
+    void decode(const uint8_t *buf) {
+        this->unique_id = nrf_read_le(&buf[0], 8);
+        this->address = nrf_read_le(&buf[8], 5);
+        this->channel = buf[13];
+    }
+};
+
+// Pairing Record, what a host needs to resume its session after a reboot
+// without pairing again, see get_pairing_record() and begin(record)
+// keep it wherever survives the reboot (EEPROM, flash, RTC memory)
+// as 23 bytes: program_id (8), unique_id (8), address (5),
+// channel (1), payload_size (1)
+struct PairingRecord {
+    static constexpr uint8_t size = 23;
+
+    uint64_t program_id;
+    uint64_t unique_id;
+    uint64_t address;
+    uint8_t channel;
+    uint8_t payload_size;
+
+    void encode(uint8_t *buf) const {
+        nrf_write_le(&buf[0], this->program_id, 8);
+        nrf_write_le(&buf[8], this->unique_id, 8);
+        nrf_write_le(&buf[16], this->address, 5);
+        buf[21] = this->channel;
+        buf[22] = this->payload_size;
+    }
+
+    void decode(const uint8_t *buf) {
+        this->program_id = nrf_read_le(&buf[0], 8);
+        this->unique_id = nrf_read_le(&buf[8], 8);
+        this->address = nrf_read_le(&buf[16], 5);
+        this->channel = buf[21];
+        this->payload_size = buf[22];
+    }
+};
+
+// Link statistics, see get_stats()
+// the dongle counts for all its hosts together
+struct NRFStats {
+    // host: data, ping, control and pairing packets written
+    // dongle: reply and accept packets loaded onto ACKs
+    uint32_t frames_sent;
+    // host only, packets the dongle acknowledged / that ran out of retries
+    uint32_t frames_acked;
+    uint32_t frames_failed;
+    // host only, packets of a failed burst that were still in the radio's
+    // FIFO besides the one that failed, they may or may not have got through,
+    // frames_sent is frames_acked + frames_failed + frames_unconfirmed
+    uint32_t frames_unconfirmed;
+    // host only, retransmissions of retransmit_frames of the packets written,
+    // a burst only reads them for its last packet, as the radio restarts
+    // its count with every packet it sends while the burst is queueing
+    uint32_t retransmits;
+    uint32_t retransmit_frames;
+    // host: pings sent, dongle: pings received
+    uint32_t pings;
+    // dongle only, time its radio was powered down, see set_duty_cycle()
+    uint32_t sleep_millis;
+    // host: pairs lost / made, dongle: hosts dropped / paired
+    uint32_t unpairs;
+    uint32_t pairs;
+    // host only, lost dongles found again without pairing
+    uint32_t reconnects;
+    // host: ACK payloads received, dongle: packets received
+    uint32_t frames_received;
+    // host only, data packets sent again by the reliable mode
+    uint32_t resends;
+    // dongle only, data packets dropped as repeats / missing from the sequence
+    uint32_t duplicates;
+    uint32_t gaps;
+    // dongle only, items sent in fragments that were dropped
+    // as not all their fragments arrived
+    uint32_t incomplete;
+    // host: items sent as deltas, dongle: items rebuilt from them
+    uint32_t deltas;
+    // dongle only, delta packets dropped as the item they build on was lost
+    uint32_t unreferenced;
+    // items dropped or refused by a full send queue (host)
+    // or host buffer (dongle), see set_overflow_policy()
+    uint32_t overflows;
+    // most items queued at once since the last reset, see get_high_water_mark()
+    uint8_t queue_high_water;
+    // host only, round trip of the acknowledged pings, retransmits included
+    uint32_t ping_rtt_min_micros;
+    uint32_t ping_rtt_avg_micros;
+    uint32_t ping_rtt_max_micros;
+    // time spent in update()
+    uint32_t updates;
+    uint32_t update_min_micros;
+    uint32_t update_avg_micros;
+    uint32_t update_max_micros;
+};
+
+// Latency histograms, see get_latency(), kept by a dongle
+// with NRF_PACKET_TIMESTAMP defined, for all its hosts together
+// counts per bucket, bucket i holds values below bucket_micros(i)
+struct NRFLatency {
+    // data packets by the latency of their oldest item,
+    // from send() on the host to the dongle receiving it
+    uint32_t latency[_LATENCY_BUCKETS_];
+    // data packets by how much their latency changed
+    // from the host's data packet before them
+    uint32_t jitter[_LATENCY_BUCKETS_];
+
+    static uint8_t bucket(uint32_t micros_value) {
+        uint8_t i = 0;
+        while (i < _LATENCY_BUCKETS_ - 1 && micros_value >= bucket_micros(i)) {
+            i++;
+        }
+        return i;
+    }
+
+    // upper bound of a bucket, UINT32_MAX for the last one
+    static uint32_t bucket_micros(uint8_t i) {
+        return i < _LATENCY_BUCKETS_ - 1 ? (uint32_t)1 << (i + _LATENCY_SHIFT_) : UINT32_MAX;
+    }
+
+    // upper bound of the bucket the p-th fraction (0 to 1) of counts falls in,
+    // e.g. percentile_micros(latency, 0.99), 0 if there are no counts
+    static uint32_t percentile_micros(const uint32_t *counts, float p) {
+        uint32_t total = 0;
+        for (uint8_t i = 0; i < _LATENCY_BUCKETS_; i++) {
+            total += counts[i];
+        }
+        if (total == 0) {
+            return 0;
+        }
+
+        uint32_t seen = 0;
+        for (uint8_t i = 0; i < _LATENCY_BUCKETS_; i++) {
+            seen += counts[i];
+            if (seen > 0 && seen >= p * total) {
+                return bucket_micros(i);
+            }
+        }
+        return UINT32_MAX;
     }
+};
+
+// Repeater statistics, see NRFRepeater::get_stats()
+// all zeros unless NRF_STATS is defined, the two hops count
+// the rest on their own links (see NRFDongle::get_stats())
+struct NRFRepeaterStats {
+    // items moved from the upstream buffers into the downstream queue
+    uint32_t forwarded;
+    // forwarded items the downstream dongle acknowledged,
+    // and those the downstream hop gave up on or dropped
+    uint32_t delivered;
+    uint32_t lost;
+    // replies moved from the downstream link back up
+    uint32_t replies;
+    // from forwarding an item to the downstream dongle acknowledging
+    // the packet it went out in, for the oldest item of each packet,
+    // minimum starts at UINT32_MAX
+    uint32_t hop_min_micros;
+    uint32_t hop_avg_micros;
+    uint32_t hop_max_micros;
+};
+
+// roles, see NRFLink, empty types that only pick a build of nrf_link.h
+struct NRFHostRole {};
+struct NRFDongleRole {};
+
+// radios, see NRFLink, what the link calls for what differs between them.
+// a backend has the Radio it drives, the Pins the link is given for it,
+// the slowest data rate the adaptive link steps down to,
+// and static methods to begin(), set the data rate and power level,
+// mask the IRQ pin (NRF_IRQ), and start_write() a packet
+// and poll_write() until it is done (see set_update_budget())
+
+// the pins of a radio that takes none
+struct NRFNoPins {
+    NRFNoPins(uint8_t, uint8_t, uint8_t, uint8_t, uint8_t) {}
+};
+
+// writes for a radio that runs the retries in hardware,
+// poll_write() returns false while the packet is in flight,
+// then true with whether it was acknowledged
+template <typename TRadio> struct NRFHardwareWrite {
+    static inline void start_write(TRadio &radio, uint8_t *bytes, uint8_t size, bool &delivered) {
+        (void)delivered;
+        radio.startWrite(bytes, size, false);
+    }
+
+    static inline bool poll_write(TRadio &radio, bool &delivered) {
+        // TX_DS or MAX_RT, reading them clears them
+        bool tx_ok, tx_fail, rx_ready;
+        radio.whatHappened(tx_ok, tx_fail, rx_ready);
+        if (!tx_ok && !tx_fail) {
+            return false;
+        }
+        delivered = tx_ok;
 
-    if (!this->paired){
+        // a packet out of retries stays in the TX FIFO
+        if (tx_fail) {
+            radio.flush_tx();
+        }
         return true;
     }
+};
 
-    this->paired = false;
-    this->address = _PAIR_ADDRESS_;
-    this->channel = _PAIR_CHANNEL_;
+#ifdef NRF24
+    struct NRF24Backend : NRFHardwareWrite<RF24> {
+        typedef RF24 Radio;
+
+        // the SPI wiring, see NRFDongle()
+        struct Pins {
+            uint8_t ce;
+            uint8_t csn;
+            uint8_t rx;
+            uint8_t sck;
+            uint8_t tx;
+            Pins(uint8_t ce, uint8_t csn, uint8_t rx, uint8_t sck, uint8_t tx) : ce(ce), csn(csn), rx(rx), sck(sck), tx(tx) {}
+        };
+
+        static const uint8_t rate_slowest = 0;
+
+        static inline void begin(Radio &radio, const Pins &pins) {
+            SPI.setRX(pins.rx);
+            SPI.setTX(pins.tx);
+            SPI.setSCK(pins.sck);
+            SPI.setCS(pins.csn);
+            SPI.begin(true);
+
+            radio.begin(&SPI, pins.ce, pins.csn);
+        }
 
-    // set the channel
-    this->radio.setChannel(channel);
+        static inline bool set_data_rate(Radio &radio, uint8_t rate) {
+            return radio.setDataRate((rf24_datarate_e)rate);
+        }
 
-    // set the payload size to the size of the pairing packet during pairing
-    // later, we will set the payload size to the size of the data packet
-    this->radio.setPayloadSize(sizeof(PairingPacket));
+        static inline void set_power_level(Radio &radio, uint8_t level) {
+            radio.setPALevel((rf24_pa_dbm_e)level);
+        }
 
-    // host opens writing pipe
-    // dongle opens reading pipe
-    #ifdef NRF_HOST
-        this->radio.openWritingPipe(this->address);
-    #endif // NRF_HOST
-    #ifdef NRF_DONGLE
-        this->radio.openReadingPipe(1, this->address);
-    #endif // NRF_DONGLE
+        // only received packets pull the IRQ pin low,
+        // not the ACK payloads going out
+        static inline void mask_irq(Radio &radio) {
+            radio.maskIRQ(true, true, false);
+        }
+    };
+#endif // NRF24
 
-    // start listening on the dongle
+#ifdef NRF52
+    struct NRF52Backend {
+        typedef nrf_to_nrf Radio;
+        typedef NRFNoPins Pins;
+
+        // the nRF52840 has no 250 kbps mode
+        static const uint8_t rate_slowest = 1;
+
+        static inline void begin(Radio &radio, const Pins &pins) {
+            (void)pins;
+            radio.begin();
+        }
+
+        static inline bool set_data_rate(Radio &radio, uint8_t rate) {
+            return radio.setDataRate(rate);
+        }
+
+        static inline void set_power_level(Radio &radio, uint8_t level) {
+            radio.setPALevel(level);
+        }
+
+        // the radio interrupt is not a pin, there is nothing to mask
+        static inline void mask_irq(Radio &radio) {
+            (void)radio;
+        }
+
+        // nrf_to_nrf runs the retries in software, so this blocks
+        // and poll_write() has the outcome at once
+        static inline void start_write(Radio &radio, uint8_t *bytes, uint8_t size, bool &delivered) {
+            delivered = radio.write(bytes, size);
+        }
+
+        static inline bool poll_write(Radio &radio, bool &delivered) {
+            (void)radio;
+            (void)delivered;
+            return true;
+        }
+    };
+#endif // NRF52
+
+#ifdef NRF_SIM
+    struct NRFSimBackend : NRFHardwareWrite<SimRadio> {
+        typedef SimRadio Radio;
+        typedef NRFNoPins Pins;
+
+        static const uint8_t rate_slowest = 0;
+
+        static inline void begin(Radio &radio, const Pins &pins) {
+            (void)pins;
+            radio.begin();
+        }
+
+        static inline bool set_data_rate(Radio &radio, uint8_t rate) {
+            return radio.setDataRate(rate);
+        }
+
+        static inline void set_power_level(Radio &radio, uint8_t level) {
+            radio.setPALevel(level);
+        }
+
+        // the simulated IRQ only fires for received packets
+        static inline void mask_irq(Radio &radio) {
+            (void)radio;
+        }
+    };
+#endif // NRF_SIM
+
+// the link built for a role, specialized below for each one
+template <typename Role> struct NRFLinkOf {
+    static_assert(sizeof(Role) == 0, "no link for this role, use NRFHostRole or NRFDongleRole");
+};
+
+#define NRF_LINK_OF(role, space) \
+    template <> struct NRFLinkOf<role> { \
+        template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> using type = space::NRFDongle<Backend, TData, max_packets, TReply, max_replies>; \
+    };
+
+// build nrf_link.h once for each role, for all radios,
+// a link that is never used is a template that is never instantiated
+#define NRF_LINK_HOST
+namespace nrf_link_host {
+    #include "nrf_link.h"
+}
+#undef NRF_LINK_HOST
+NRF_LINK_OF(NRFHostRole, nrf_link_host)
+
+#define NRF_LINK_DONGLE
+#ifdef NRF_IRQ
+    #define NRF_LINK_IRQ
+#endif // NRF_IRQ
+namespace nrf_link_dongle {
+    #include "nrf_link.h"
+}
+#undef NRF_LINK_IRQ
+#undef NRF_LINK_DONGLE
+NRF_LINK_OF(NRFDongleRole, nrf_link_dongle)
+
+#undef NRF_LINK_OF
+
+// a host or dongle on a radio, sending TData to the dongle
+// and TReply back to the host, see nrf_link.h
+template <typename Role, typename Backend, typename TData, uint8_t max_packets, typename TReply = TData, uint8_t max_replies = max_packets>
+using NRFLink = typename NRFLinkOf<Role>::template type<Backend, TData, max_packets, TReply, max_replies>;
+
+// NRFDongle is the link for NRF_HOST or NRF_DONGLE on the radio defined
+#if defined(NRF_HOST) || defined(NRF_DONGLE)
     #ifdef NRF_HOST
-        this->radio.stopListening();
+        typedef NRFHostRole NRFRole;
+    #else
+        typedef NRFDongleRole NRFRole;
     #endif // NRF_HOST
-    #ifdef NRF_DONGLE
-        this->radio.startListening();
-    #endif // NRF_DONGLE
 
-    // reset timers
-    this->ping_timer = 0;
-    this->pair_timer = 0;
+    #if defined(NRF24)
+        typedef NRF24Backend NRFBackend;
+    #elif defined(NRF52)
+        typedef NRF52Backend NRFBackend;
+    #else
+        typedef NRFSimBackend NRFBackend;
+    #endif // NRF24
 
-    return true;
-}
+    typedef NRFBackend::Radio Radio;
+
+    template <typename TData, uint8_t max_packets, typename TReply = TData, uint8_t max_replies = max_packets>
+    using NRFDongle = NRFLink<NRFRole, NRFBackend, TData, max_packets, TReply, max_replies>;
+#endif // NRF_HOST || NRF_DONGLE
+
+// a node between a host and a dongle that are too far apart for one link,
+// a dongle to the upstream host(s) and a host to the downstream dongle.
+// update() moves the items the upstream link received straight from its
+// buffers into the downstream link's send queue, and the replies the
+// downstream dongle sends back up to the host the last item came from.
+// items wait upstream while the downstream queue is full, or while the
+// downstream link is not paired, and are lost there by its overflow policy.
+// the two links are built and set up as usual, on two radios, and the
+// upstream and downstream program ids should differ so the upstream host
+// only pairs with the repeater. give the downstream link an update budget
+// (see set_update_budget()) so a packet in flight there does not hold up
+// the upstream one, and both directions move in every update()
+template <typename UpBackend, typename DownBackend, typename TData, uint8_t max_packets, typename TReply = TData, uint8_t max_replies = max_packets> class NRFRepeater {
+    public:
+        typedef NRFLink<NRFDongleRole, UpBackend, TData, max_packets, TReply, max_replies> Upstream;
+        typedef NRFLink<NRFHostRole, DownBackend, TData, max_packets, TReply, max_replies> Downstream;
 
-// Is Paired
-template <typename TData, uint8_t max_packets> bool NRFDongle<TData, max_packets>::is_paired() {
-    return this->paired;
-}
+        // the downstream link's send callback is taken by the repeater
+        NRFRepeater(Upstream &upstream, Downstream &downstream);
 
-// Is Enabled
-template <typename TData, uint8_t max_packets> bool NRFDongle<TData, max_packets>::is_enabled() {
-    return this->enabled;
-}
+        void begin();
+        void update();
+        void end();
 
-// Get Address
-template <typename TData, uint8_t max_packets> uint64_t NRFDongle<TData, max_packets>::get_address() {
-    return this->address;
-}
+        // true once both hops are paired
+        bool is_paired();
 
-// Get Unique ID
-template <typename TData, uint8_t max_packets> uint64_t NRFDongle<TData, max_packets>::get_unique_id() {
-    return this->unique_id;
-}
+        // what the repeater has moved since begin() or reset_stats()
+        NRFRepeaterStats get_stats();
+        void reset_stats();
+
+    private:
+        Upstream &upstream;
+        Downstream &downstream;
+        // the upstream host forwarding starts from, taking turns,
+        // and the one replies go back to
+        uint8_t next_host = 0;
+        uint8_t reply_host = 0;
+
+        #ifdef NRF_STATS
+            NRFRepeaterStats stats;
+            uint32_t hops = 0;
+            uint64_t hop_total_micros = 0;
+            // micros() each item in the downstream queue, or in the packets
+            // it has out (a burst or a reliable window, 4 at most),
+            // was forwarded at
+            static constexpr uint16_t outstanding = max_packets + _RELIABLE_WINDOW_ * Packet<TData>::max_items;
+            NRFRing<uint32_t, (outstanding > 255 ? 255 : outstanding)> forwarded_micros;
+
+            static void sent(bool delivered, uint8_t items, void *context);
+        #endif // NRF_STATS
+
+        void forward_items();
+        void forward_replies();
+};
 
-// Get Program ID
-template <typename TData, uint8_t max_packets> uint64_t NRFDongle<TData, max_packets>::get_program_id() {
-    return this->program_id;
+// Constructor
+template <typename UpBackend, typename DownBackend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> NRFRepeater<UpBackend, DownBackend, TData, max_packets, TReply, max_replies>::NRFRepeater(Upstream &upstream, Downstream &downstream) : upstream(upstream), downstream(downstream) {
+    this->reset_stats();
 }
 
-// Get Channel
-template <typename TData, uint8_t max_packets> uint8_t NRFDongle<TData, max_packets>::get_channel() {
-    return this->channel;
+// Begin
+template <typename UpBackend, typename DownBackend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFRepeater<UpBackend, DownBackend, TData, max_packets, TReply, max_replies>::begin() {
+    #ifdef NRF_STATS
+        this->downstream.set_send_callback(sent, this);
+    #endif // NRF_STATS
+    this->upstream.begin();
+    this->downstream.begin();
 }
 
-// Set Unique ID
-template <typename TData, uint8_t max_packets> void NRFDongle<TData, max_packets>::set_unique_id(uint64_t unique_id) {
-    this->unique_id = unique_id;
+// Update
+template <typename UpBackend, typename DownBackend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFRepeater<UpBackend, DownBackend, TData, max_packets, TReply, max_replies>::update() {
+    // take in what the upstream host sent, pass it on,
+    // then send it and bring back what the downstream dongle replied
+    this->upstream.update();
+    this->forward_items();
+    this->downstream.update();
+    this->forward_replies();
 }
 
-// Has Data
-template <typename TData, uint8_t max_packets> bool NRFDongle<TData, max_packets>::has_data() {
-    return !this->buffer.isEmpty();
+// End
+template <typename UpBackend, typename DownBackend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFRepeater<UpBackend, DownBackend, TData, max_packets, TReply, max_replies>::end() {
+    this->upstream.end();
+    this->downstream.end();
 }
 
-// Get Radio
-template <typename TData, uint8_t max_packets> Radio &NRFDongle<TData, max_packets>::get_radio() {
-    return this->radio;
+// Is Paired
+template <typename UpBackend, typename DownBackend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFRepeater<UpBackend, DownBackend, TData, max_packets, TReply, max_replies>::is_paired() {
+    return this->upstream.is_paired() && this->downstream.is_paired();
 }
 
-// Try Pair
-template <typename TData, uint8_t max_packets> bool NRFDongle<TData, max_packets>::try_pair() {
+// Get Stats
+template <typename UpBackend, typename DownBackend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> NRFRepeaterStats NRFRepeater<UpBackend, DownBackend, TData, max_packets, TReply, max_replies>::get_stats() {
+    #ifdef NRF_STATS
+        NRFRepeaterStats stats = this->stats;
+        stats.hop_avg_micros = this->hops ? (uint32_t)(this->hop_total_micros / this->hops) : 0;
+        return stats;
+    #else
+        NRFRepeaterStats stats;
+        memset(&stats, 0, sizeof(stats));
+        return stats;
+    #endif // NRF_STATS
+}
 
-    if (!this->enabled){
-        return false;
-    }
+// Reset Stats
+template <typename UpBackend, typename DownBackend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFRepeater<UpBackend, DownBackend, TData, max_packets, TReply, max_replies>::reset_stats() {
+    #ifdef NRF_STATS
+        memset(&this->stats, 0, sizeof(this->stats));
+        this->stats.hop_min_micros = UINT32_MAX;
+        this->hops = 0;
+        this->hop_total_micros = 0;
+    #endif // NRF_STATS
+}
 
-    if (this->paired){
-        return true;
+// Forward Items
+template <typename UpBackend, typename DownBackend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFRepeater<UpBackend, DownBackend, TData, max_packets, TReply, max_replies>::forward_items() {
+    // a downstream link that is not paired takes nothing, what it
+    // already holds waits for the next session, or is reported lost
+    if (!this->downstream.is_paired()) {
+        return;
     }
 
-    // if we are the host, we send our unique_id
-    // if the message is market as received, we are paired
-    #ifdef NRF_HOST
-
-        // create a pairing packet
-        PairingPacket pairing_packet;
-        pairing_packet.unique_id = this->unique_id;
-        pairing_packet.program_id = this->program_id;
-        pairing_packet.ping_interval_millis = this->ping_interval_millis;
-
-        bool report = this->radio.write(&pairing_packet, sizeof(PairingPacket));
-
-        // if the message was received, we are paired
-        // and we need to switch our channel, address,
-        // and payload size
-        if (report) {
-            this->paired = true;
-            this->address = this->unique_id;
-            // the channel is the unique_id modulo 73 plus 1
-            this->channel = this->unique_id % 73 + 1;
-            this->pair_timer = 0;
-            this->ping_timer = 0;
-
-            this->radio.setChannel(this->channel);
-            this->radio.openWritingPipe(this->address);
-            this->radio.setPayloadSize(sizeof(Packet<TData>));
-            this->radio.stopListening();
-        }
-        return report;
-    #endif // NRF_HOST
-
-    // if we are the dongle, we wait to receive the unique_id
-    // if we receive a payload that is the right size, we are paired
-    #ifdef NRF_DONGLE
-        if (this->radio.available()) {
-            uint8_t size = this->radio.getPayloadSize();
-            // check if the size is the size of the pairing packet
-            if (size == sizeof(PairingPacket)) {
-                // read the packet
-                PairingPacket pairing_packet;
-                this->radio.read(&pairing_packet, sizeof(PairingPacket));
-
-                // check if the program_id matches
-                if (pairing_packet.program_id != this->program_id) {
-                    return false;
+    // straight from the upstream buffers, in place,
+    // as many as the downstream queue has room for
+    for (uint8_t n = 0; n < NRF_MAX_HOSTS; n++) {
+        uint8_t host = (this->next_host + n) % NRF_MAX_HOSTS;
+        const TData *items;
+        size_t count;
+        while ((count = this->upstream.peek(items, host)) > 0) {
+            uint8_t room = this->downstream.get_queue_room();
+            #ifdef NRF_STATS
+                // and the repeater has to time them all
+                uint8_t timed = this->forwarded_micros.capacity() - this->forwarded_micros.size();
+                if (timed < room) {
+                    room = timed;
                 }
-
-                uint64_t unique_id = pairing_packet.unique_id;
-                uint16_t ping_interval_millis = pairing_packet.ping_interval_millis;
-                this->address = unique_id;
-                // the channel is the unique_id modulo 73 plus 1
-                this->channel = unique_id % 73 + 1;
-                this->radio.setChannel(this->channel);
-                this->ping_interval_millis = ping_interval_millis;
-                this->radio.openReadingPipe(1, this->address);
-                this->radio.setPayloadSize(sizeof(Packet<TData>));
-                this->radio.startListening();
-                this->paired = true;
-                this->pair_timer = 0;
-                this->ping_timer = 0;
-                return true;
+            #endif // NRF_STATS
+            if (room == 0) {
+                return;
             }
+            if (count > room) {
+                count = room;
+            }
+            for (size_t i = 0; i < count; i++) {
+                this->downstream.send(items[i]);
+                #ifdef NRF_STATS
+                    this->forwarded_micros.push(micros());
+                #endif // NRF_STATS
+            }
+            this->upstream.consume(count, host);
+            this->reply_host = host;
+            #ifdef NRF_STATS
+                this->stats.forwarded += count;
+            #endif // NRF_STATS
         }
-        return false;
-    #endif // NRF_DONGLE
+    }
+    this->next_host = (this->next_host + 1) % NRF_MAX_HOSTS;
 }
 
-// Send
-#ifdef NRF_HOST
-    template <typename TData, uint8_t max_packets> bool NRFDongle<TData, max_packets>::send(TData data, bool send_now) {
-        if (!this->enabled){
-            return false;
+// Forward Replies
+template <typename UpBackend, typename DownBackend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFRepeater<UpBackend, DownBackend, TData, max_packets, TReply, max_replies>::forward_replies() {
+    // a reply stays downstream until the upstream host can take it
+    TReply reply;
+    while (this->downstream.read(reply, false)) {
+        if (!this->upstream.send(reply, this->reply_host)) {
+            return;
         }
+        this->downstream.read(reply);
+        #ifdef NRF_STATS
+            this->stats.replies++;
+        #endif // NRF_STATS
+    }
+}
 
-        if (!this->paired){
-            return false;
+// Sent
+#ifdef NRF_STATS
+    template <typename UpBackend, typename DownBackend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFRepeater<UpBackend, DownBackend, TData, max_packets, TReply, max_replies>::sent(bool delivered, uint8_t items, void *context) {
+        // a downstream packet is done, or the link dropped items,
+        // either way they went out oldest first
+        NRFRepeater *repeater = (NRFRepeater *)context;
+        if (items == 0 || repeater->forwarded_micros.isEmpty()) {
+            return;
         }
 
-        // if we are not sending now, push the packet
-        if (!send_now) {
-            this->buffer.push(data);
-            return true;
+        if (delivered) {
+            uint32_t taken = micros() - repeater->forwarded_micros.first();
+            repeater->stats.delivered += items;
+            repeater->hops++;
+            repeater->hop_total_micros += taken;
+            if (taken < repeater->stats.hop_min_micros) {
+                repeater->stats.hop_min_micros = taken;
+            }
+            if (taken > repeater->stats.hop_max_micros) {
+                repeater->stats.hop_max_micros = taken;
+            }
+        } else {
+            repeater->stats.lost += items;
         }
+        repeater->forwarded_micros.consume(items);
+    }
+#endif // NRF_STATS
+
+// a dongle's items streamed to a PC over a serial port (or any other Print)
+// as binary records, instead of printing them as text. each item is a record:
+//     micros() when the sink took it from the dongle (4 bytes, little endian)
+//     the host it came from (1 byte, 0 to NRF_MAX_HOSTS - 1)
+//     the item, sizeof(TData) bytes as they are in memory
+//     CRC-16/CCITT-FALSE of all of the above (2 bytes, little endian)
+// COBS encoded, so it has no zero bytes, and followed by a zero byte,
+// so a reader can start anywhere in the stream and is back in step
+// at the next zero. records are gathered in a buffer of NRF_SINK_BUFFER
+// bytes and written with one write() each time it fills up, or once the
+// oldest record has waited the flush interval, so the port sees a few
+// large writes rather than a print per value. what a busy port does not
+// take stays in the buffer and is written again on the next update(),
+// and while the buffer has no room for a record, records are dropped
+// (see get_dropped_records()).
+// extras/stream has a decoder for Linux
+template <typename Backend, typename TData, uint8_t max_packets, typename TReply = TData, uint8_t max_replies = max_packets> class NRFSerialSink {
+    public:
+        typedef NRFLink<NRFDongleRole, Backend, TData, max_packets, TReply, max_replies> Dongle;
 
-        // if we are sending now, send the packet
-        Packet<TData> packet;
-        packet.data = data;
-        bool report = this->radio.write(&packet, sizeof(Packet<TData>));
+        // the dongle is read through peek() / consume(),
+        // read() is left for nothing else to take its items
+        NRFSerialSink(Dongle &dongle, Print &out);
 
-        // if the packet was received, reset the ping timer
-        if (report) {
-            this->ping_timer = 0;
-        }
+        // move every item the dongle holds into records,
+        // call it after the dongle's update()
+        void update();
 
-        return report;
-    }
-#endif // NRF_HOST
+        // write the records gathered so far,
+        // keeping what the port does not take for the next one
+        void flush();
 
-// Ping
-#ifdef NRF_HOST
-    template <typename TData, uint8_t max_packets> bool NRFDongle<TData, max_packets>::ping() {
-        // returns true if ping was sent and acknowledged
-        // or if there is no need to ping
-        // returns false if the ping was sent but not acknowledged
-        // therefore signaling that the pair is broken
+        // how long a record may wait for more before they are written,
+        // 0 writes at the end of every update() that made any
+        // (default _SINK_FLUSH_MILLIS_)
+        void set_flush_interval(uint16_t flush_interval_millis);
 
-        if (!this->enabled){
-            return true;
-        }
+        // records dropped as the buffer was still full,
+        // the port not keeping up with what the dongle receives
+        uint32_t get_dropped_records() const;
 
-        if (!this->paired){
-            return true;
+    private:
+        static constexpr size_t record_size = 4 + 1 + sizeof(TData) + 2;
+        // COBS adds a byte for every 254 and one more, then the zero
+        static constexpr size_t max_encoded_size = record_size + record_size / 254 + 2;
+        static_assert(max_encoded_size <= NRF_SINK_BUFFER, "NRF_SINK_BUFFER must hold at least one record");
+
+        Dongle &dongle;
+        Print &out;
+        uint8_t buffer[NRF_SINK_BUFFER];
+        size_t length = 0;
+        // the record being encoded: where its current COBS code byte goes,
+        // the code so far, and the CRC so far
+        size_t code_index = 0;
+        uint8_t code = 0;
+        uint16_t crc = 0;
+        uint16_t flush_interval_millis = _SINK_FLUSH_MILLIS_;
+        elapsedMillis flush_timer;
+        // the host draining starts from, taking turns
+        uint8_t next_host = 0;
+        uint32_t dropped_records = 0;
+
+        void add_record(uint32_t time, uint8_t host, const TData &item);
+        void put(uint8_t byte);
+        void put_checked(uint8_t byte);
+};
+
+// Constructor
+template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> NRFSerialSink<Backend, TData, max_packets, TReply, max_replies>::NRFSerialSink(Dongle &dongle, Print &out) : dongle(dongle), out(out) {
+}
+
+// Update
+template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFSerialSink<Backend, TData, max_packets, TReply, max_replies>::update() {
+    // straight from the dongle's buffers, in place, a run at a time
+    for (uint8_t n = 0; n < NRF_MAX_HOSTS; n++) {
+        uint8_t host = (this->next_host + n) % NRF_MAX_HOSTS;
+        const TData *items;
+        size_t count;
+        while ((count = this->dongle.peek(items, host)) > 0) {
+            uint32_t now = micros();
+            for (size_t i = 0; i < count; i++) {
+                this->add_record(now, host, items[i]);
+            }
+            this->dongle.consume(count, host);
         }
+    }
+    this->next_host = (this->next_host + 1) % NRF_MAX_HOSTS;
 
-        if (this->ping_timer > this->ping_interval_millis) {
-            this->ping_timer = 0;
+    if (this->length > 0 && this->flush_timer >= this->flush_interval_millis) {
+        this->flush();
+    }
+}
 
-            // create a ping packet
+// Flush
+template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFSerialSink<Backend, TData, max_packets, TReply, max_replies>::flush() {
+    if (this->length == 0) {
+        return;
+    }
 
-            Packet<TData> ping_packet;
-            ping_packet.ping = true;
+    // a port that takes less (its own buffer is full) leaves the rest
+    // at the front, to be written first the next time
+    size_t written = this->out.write(this->buffer, this->length);
+    if (written < this->length) {
+        memmove(this->buffer, &this->buffer[written], this->length - written);
+        this->length -= written;
+        return;
+    }
+    this->length = 0;
+}
 
+// Set Flush Interval
+template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFSerialSink<Backend, TData, max_packets, TReply, max_replies>::set_flush_interval(uint16_t flush_interval_millis) {
+    this->flush_interval_millis = flush_interval_millis;
+}
 
-            bool report = this->radio.write(&ping_packet, sizeof(Packet<TData>));
+// Get Dropped Records
+template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> uint32_t NRFSerialSink<Backend, TData, max_packets, TReply, max_replies>::get_dropped_records() const {
+    return this->dropped_records;
+}
 
-            return report;
+// Add Record
+template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFSerialSink<Backend, TData, max_packets, TReply, max_replies>::add_record(uint32_t time, uint8_t host, const TData &item) {
+    // make room for the record as long as it can get, once encoded,
+    // if the port still holds up what was there, the record is dropped
+    // whole, so the stream never has one cut short
+    if (this->length + max_encoded_size > NRF_SINK_BUFFER) {
+        this->flush();
+        if (this->length + max_encoded_size > NRF_SINK_BUFFER) {
+            this->dropped_records++;
+            return;
         }
+    }
+    if (this->length == 0) {
+        this->flush_timer = 0;
+    }
 
-        return true;
+    // the first code byte, filled in once its run of bytes is known
+    this->code_index = this->length++;
+    this->code = 1;
+    this->crc = 0xFFFF;
+
+    for (uint8_t i = 0; i < 4; i++) {
+        this->put_checked((uint8_t)(time >> (8 * i)));
     }
-#endif // NRF_HOST
+    this->put_checked(host);
+    const uint8_t *bytes = (const uint8_t *)&item;
+    for (size_t i = 0; i < sizeof(TData); i++) {
+        this->put_checked(bytes[i]);
+    }
+    uint16_t crc = this->crc;
+    this->put((uint8_t)crc);
+    this->put((uint8_t)(crc >> 8));
 
-// Read
-#ifdef NRF_DONGLE
-    template <typename TData, uint8_t max_packets> bool NRFDongle<TData, max_packets>::read(TData &data, bool pop) {
-        if (!this->enabled){
-            return false;
-        }
+    this->buffer[this->code_index] = this->code;
+    this->buffer[this->length++] = 0;
+}
 
-        if (!this->paired){
-            return false;
+// Put
+template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFSerialSink<Backend, TData, max_packets, TReply, max_replies>::put(uint8_t byte) {
+    // COBS: a zero ends the run and becomes the next code byte,
+    // as does a run of 254 bytes, whose code 0xFF stands for no zero
+    if (byte != 0) {
+        this->buffer[this->length++] = byte;
+        this->code++;
+        if (this->code < 0xFF) {
+            return;
         }
+    }
+    this->buffer[this->code_index] = this->code;
+    this->code_index = this->length++;
+    this->code = 1;
+}
 
-        if (this->buffer.isEmpty()){
-            return false;
-        }
+// Put Checked
+template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFSerialSink<Backend, TData, max_packets, TReply, max_replies>::put_checked(uint8_t byte) {
+    this->crc = nrf_crc16(this->crc, byte);
+    this->put(byte);
+}
 
-        if (pop) {
-            data = this->buffer.pop();
-        } else {
-            data = this->buffer.last();
-        }
+// a handler for each type of an NRFMessage, for the messages a dongle reads:
+//     NRFHandlers<Sample, Status> handlers;
+//     handlers.on<Status>(on_status);
+//     while (dongle.read(message, host)) handlers.dispatch(message, host);
+// a handler gets a copy of the message, the host it came from,
+// and the context it was set with
+template <typename... Types> class NRFHandlers {
+    public:
+        typedef NRFMessage<Types...> Message;
 
-        return true;
+        NRFHandlers();
+
+        // set the handler for messages of type T, nullptr for none
+        template <typename T> void on(void (*handler)(const T &message, uint8_t host, void *context), void *context = nullptr);
+
+        // call the handler for the message's type,
+        // returns false if it has none
+        bool dispatch(const Message &message, uint8_t host = 0);
+
+    private:
+        // handlers of every type are kept as one kind of function pointer,
+        // and called through a function that knows their type
+        typedef void (*AnyHandler)();
+        typedef void (*Call)(AnyHandler handler, const Message &message, uint8_t host, void *context);
+
+        struct Entry {
+            Call call;
+            AnyHandler handler;
+            void *context;
+        };
+        Entry entries[Message::type_count];
+
+        template <typename T> static void call(AnyHandler handler, const Message &message, uint8_t host, void *context);
+};
+
+// Constructor
+template <typename... Types> NRFHandlers<Types...>::NRFHandlers() {
+    memset(this->entries, 0, sizeof(this->entries));
+}
+
+// On
+template <typename... Types> template <typename T> void NRFHandlers<Types...>::on(void (*handler)(const T &message, uint8_t host, void *context), void *context) {
+    Entry &entry = this->entries[Message::template tag_of<T>()];
+    entry.call = call<T>;
+    entry.handler = (AnyHandler)handler;
+    entry.context = context;
+}
+
+// Dispatch
+template <typename... Types> bool NRFHandlers<Types...>::dispatch(const Message &message, uint8_t host) {
+    if (message.tag >= Message::type_count) {
+        return false;
+    }
+
+    const Entry &entry = this->entries[message.tag];
+    if (entry.handler == nullptr) {
+        return false;
     }
-#endif // NRF_DONGLE
+    entry.call(entry.handler, message, host, entry.context);
+    return true;
+}
+
+// Call
+template <typename... Types> template <typename T> void NRFHandlers<Types...>::call(AnyHandler handler, const Message &message, uint8_t host, void *context) {
+    // copied out of the message, whose bytes may not be aligned for T
+    T typed;
+    message.get(typed);
+    ((void (*)(const T &, uint8_t, void *))handler)(typed, host, context);
+}
+
+#ifdef NRF_DONGLE_NAMESPACE
+} // namespace NRF_DONGLE_NAMESPACE
+#endif // NRF_DONGLE_NAMESPACE
 
 #endif // NRF_DONGLE_H
+
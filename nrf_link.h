@@ -0,0 +1,3797 @@
+// ============ NOTE ============
+// The link itself, included by nrf_dongle.h once for each role,
+// do not include it directly. each time one of NRF_LINK_HOST or
+// NRF_LINK_DONGLE is defined, and it lands in its own namespace
+// (see NRFLink), so the other role is not compiled in at all.
+// the radio is the Backend template parameter, which the link
+// calls for what differs between radios (see NRF24Backend)
+// ==============================
+
+#if !defined(NRF_DONGLE_H) || defined(NRF_LINK_HOST) == defined(NRF_LINK_DONGLE)
+    #error "nrf_link.h is built by nrf_dongle.h, include nrf_dongle.h instead"
+    #define NRF_LINK_BUILT
+#endif
+
+// an include guard for each role, as each is its own build,
+// a second include of the same one adds nothing
+#if defined(NRF_LINK_HOST)
+    #ifdef NRF_LINK_HOST_H
+        #define NRF_LINK_BUILT
+    #endif
+    #define NRF_LINK_HOST_H
+#elif defined(NRF_LINK_DONGLE)
+    #ifdef NRF_LINK_DONGLE_H
+        #define NRF_LINK_BUILT
+    #endif
+    #define NRF_LINK_DONGLE_H
+#endif
+
+#ifndef NRF_LINK_BUILT
+
+// TData is sent from the host to the dongle,
+// TReply from the dongle back to the host, riding on the ACKs,
+// over the radio Backend is for
+template <typename Backend, typename TData, uint8_t max_packets, typename TReply = TData, uint8_t max_replies = max_packets> class NRFDongle {
+    static_assert(!Packet<TReply>::fragmented, "TReply plus the packet header must fit in the 32 byte ACK payload");
+
+    public:
+        typedef typename Backend::Radio Radio;
+
+        // take in a reference to the radio, a unique identifier for this radio
+        // the ping interval in milliseconds,
+        // pairing timeout in milliseconds (0 for no timeout),
+        // and settings for the radio:
+        //     data rate, power level,
+        //     retry delay (x+1)*250us [x = 0-15]
+        //     number of retries [0-15]
+        // the pins are the nRF24's SPI wiring, the other radios ignore them
+        NRFDongle(
+                    Radio &radio,
+                    uint64_t unique_id, // unused for dongle
+                    uint64_t program_id, // host and dongle must match
+                    uint16_t ping_interval_millis, // unused for dongle
+                    uint32_t pair_timeout_millis,
+                    uint8_t data_rate,
+                    uint8_t power_level,
+                    uint8_t retry_delay = 5, // (5+1)*250us = 1.5ms
+                    uint8_t retry_count = 15,
+                    uint8_t ce_pin = 29,
+                    uint8_t csn_pin = 5,
+                    uint8_t rx_pin = 4,
+                    uint8_t sck_pin = 2,
+                    uint8_t tx_pin = 3
+                );
+
+        void begin();
+        void update();
+        void end();
+        bool unpair();
+        bool is_paired();
+        bool is_enabled();
+        uint64_t get_address();
+        uint64_t get_unique_id();
+        uint8_t get_channel();
+        uint64_t get_program_id();
+        void set_unique_id(uint64_t unique_id);
+
+        // method for whether or not there is data in the buffer
+        bool has_data();
+
+        // data rate and PA level in use, they only differ from the
+        // constructor's while the host's adaptive link has moved them
+        uint8_t get_data_rate();
+        uint8_t get_power_level();
+
+        Radio &get_radio();
+
+        // what the link has done since begin() or reset_stats(),
+        // all zeros unless NRF_STATS is defined
+        NRFStats get_stats();
+        // also resets the high-water marks
+        void reset_stats();
+
+        // what a full buffer does with new data, one of _QUEUE_DROP_OLDEST_
+        // (default), _QUEUE_DROP_NEWEST_ or _QUEUE_REJECT_
+        // for the host its send queue, for the dongle the hosts' buffers
+        void set_overflow_policy(uint8_t policy);
+
+        #ifdef NRF_LINK_HOST
+            // begin, then resume the session in record instead of pairing,
+            // returns false (and pairs as usual) if the record is not ours.
+            // the host checks the dongle still knows it before sending
+            bool begin(const PairingRecord &record);
+
+            // the session to resume with begin(record), false if not paired
+            bool get_pairing_record(PairingRecord &record);
+
+            // true while paired and the dongle answers,
+            // is_paired() stays true while the host looks for a lost dongle
+            bool is_connected();
+
+            // how long a host that lost the dongle looks for it on the
+            // data channel, keeping its queue, before pairing again.
+            // sent to the dongle when pairing, which holds the host's slot
+            // as long. 0 pairs again at once and clears the queue
+            void set_reconnect_grace(uint16_t grace_millis);
+
+            // queue data to go out in update(), oldest first,
+            // priority data goes out ahead of everything queued without it,
+            // or send it on its own right away with send_now
+            // (in the non-blocking mode, and for a TData sent in fragments,
+            // it is queued as priority data instead)
+            // returns false if it was not queued because of _QUEUE_REJECT_
+            bool send(TData data, bool send_now = false, bool priority = false);
+
+            // called when a data packet is done, with whether the dongle
+            // got it and how many items it carried, or how many were lost
+            // with it. a burst is one call for the packets that got through,
+            // and one more for the rest if one failed. a TData sent in
+            // fragments counts as an item in its last one, or in the one
+            // that was lost, which drops the whole item. a reliable host
+            // loses no items, it sends the packet again. the items the link
+            // drops when it loses the dongle, or in end(), count as lost
+            typedef void (*SendCallback)(bool delivered, uint8_t items, void *context);
+            void set_send_callback(SendCallback callback, void *context = nullptr);
+
+            // non-blocking mode: update() starts a packet and returns,
+            // the radio retries it on its own and a later update() polls it
+            // once to collect the outcome (see set_send_callback()). when a
+            // packet is done with time left of budget_micros, the next one
+            // starts in the same update(). burst mode is not used.
+            // 0 (default) blocks in update() until each packet is acknowledged
+            // or out of retries. the scan for a quiet channel before pairing
+            // listens on one channel per update() (about 0.7 ms, whatever
+            // the budget), and the adaptive link looks for a lost dongle
+            // a packet at a time. what can not be split up still blocks:
+            // changing the adaptive link's data rate or channel (a control
+            // packet and a ping, and for a migration a scan of
+            // _MIGRATE_CANDIDATES_ channels), and every packet on the nRF52,
+            // whose library retries in software
+            void set_update_budget(uint16_t budget_micros);
+
+            // true while a packet started by update() is in flight
+            bool is_sending();
+
+            #ifdef NRF_PACKET_SEQUENCE
+                // reliable stream (off by default): data packets that are not
+                // acknowledged are sent again, in order and with their number,
+                // instead of being dropped, and the dongle drops the repeats
+                // of the ones it got but whose ACK was lost. packets are
+                // only dropped when the queue is (see set_reconnect_grace()),
+                // and can arrive twice when pairing again after a reboot.
+                // send(send_now) queues as priority data instead
+                void set_reliable(bool reliable);
+            #endif // NRF_PACKET_SEQUENCE
+
+            // most items queued at once since the last reset,
+            // max_packets can be sized from it
+            uint8_t get_high_water_mark();
+            void reset_high_water_mark();
+
+            // items send() can still queue (without priority) before
+            // the overflow policy drops or rejects one
+            uint8_t get_queue_room();
+
+            bool ping();
+
+            // method for reading replies sent back by the dongle
+            bool read(TReply &data, bool pop = true);
+
+            // method for whether or not there are replies in the reply buffer
+            bool has_reply();
+
+            // time budget in microseconds for draining the buffer in update()
+            // 0 (default) sends at most one packet per update(),
+            // or the fragments of one item if TData needs more than one
+            void set_burst_budget(uint16_t budget_micros);
+
+            // most TData sent together in one packet, applied when pairing
+            // 0 (default) packs as many as fit in the 32 byte payload
+            void set_max_items_per_packet(uint8_t max_items);
+
+            // adapt the link to the RF conditions (off by default): the host
+            // counts the retransmits of its packets, raises the PA level or
+            // drops to a slower data rate when they pile up, and goes back
+            // to faster rates while they stay clean, taking the dongle along
+            // with a control packet. the retry delay is kept as short as the
+            // ACK payloads allow at the current data rate, with as many
+            // retries as still take the time the constructor's settings did
+            void set_adaptive(bool adaptive);
+
+            // send items as the bytes that changed since the item before
+            // (off by default), packing more of them into each packet,
+            // with every keyframe_interval-th packet (and the one after a
+            // lost packet) sent in full for the dongle to build on.
+            // 0 or 1 sends every item in full, send(send_now) queues as
+            // priority data, and a TData sent in fragments is never encoded
+            void set_delta(uint8_t keyframe_interval);
+
+            // let the ping interval grow, doubling with every frame that
+            // gets through at the first try, up to max_interval_millis,
+            // and halve it with a retransmit, back to the constructor's
+            // on a lost frame. sent when pairing, the dongle waits for
+            // twice the max before dropping us. 0 (default) does not grow
+            void set_max_ping_interval(uint16_t max_interval_millis);
+
+            // only send while a duty-cycling dongle listens (see
+            // _WAKE_WINDOW_MILLIS_): right after each acknowledged frame,
+            // the rest waits for the next window, every interval_millis
+            // after it. update() must run at least every millisecond.
+            // sent when pairing (set it before begin()), 0 (default) sends
+            // whenever there is something to send
+            void set_wake_interval(uint16_t interval_millis);
+
+            // move the link to a quieter channel, taking the dongle along,
+            // once more than loss_percent of the transmissions in a window
+            // are lost. 0 (default) stays on the channel chosen when pairing
+            void set_migration_threshold(uint8_t loss_percent);
+
+            // listen over the band again for the quietest channel the next
+            // time the host pairs. the channel is otherwise found once and
+            // kept for every pairing after, until a migration finds no
+            // quieter one (see set_migration_threshold())
+            void rescan();
+        #endif // NRF_LINK_HOST
+
+        #ifdef NRF_LINK_DONGLE
+            // read the oldest item from any host,
+            // taking turns between hosts with data
+            bool read(TData &data, bool pop = true);
+
+            // same, and report which host (0 to NRF_MAX_HOSTS - 1) sent it
+            bool read(TData &data, uint8_t &host, bool pop = true);
+
+            #ifdef NRF_PACKET_TIMESTAMP
+                // same, and how long ago the host gave it to send(),
+                // by our clock, so stale items can be skipped
+                bool read(TData &data, uint8_t &host, uint32_t &age_micros, bool pop = true);
+
+                // latency and jitter histograms since the last reset
+                NRFLatency get_latency();
+                void reset_latency();
+
+                // add to a host's micros() to get ours, as estimated
+                // from its packets (see _CLOCK_WINDOW_MILLIS_)
+                uint32_t get_clock_offset(uint8_t host = 0);
+            #endif // NRF_PACKET_TIMESTAMP
+
+            // most items buffered at once for a host since the last reset
+            uint8_t get_high_water_mark(uint8_t host = 0);
+            void reset_high_water_mark(uint8_t host = 0);
+
+            // copy up to n items from a host into data, oldest first,
+            // returns how many were copied
+            size_t read_batch(TData *data, size_t n, uint8_t host = 0);
+
+            // point data at the oldest items from a host, in place in the buffer,
+            // and return how many follow it there (the rest wrap around),
+            // then consume() the ones that were handled
+            // the items stay valid until the next update()
+            size_t peek(const TData *&data, uint8_t host = 0);
+            void consume(size_t n, uint8_t host = 0);
+
+            #ifdef NRF_LINK_IRQ
+                // the radio's interrupt handler, see NRF_IRQ
+                void irq();
+            #endif // NRF_LINK_IRQ
+
+            // queue a reply for a host, it is sent on the ACK
+            // of the host's next packet or ping
+            bool send(TReply data, uint8_t host = 0);
+
+            // data packets from a host that numbers them (NRF_PACKET_SEQUENCE)
+            // that never arrived, since it paired
+            uint32_t get_missed_packets(uint8_t host = 0);
+
+            // power the radio down between the wake windows of the hosts
+            // (off by default), once every host slot is paired with a host
+            // that has a wake interval (see set_wake_interval()), and keep
+            // listening while a host has not been heard from for longer
+            // than its ping interval and a wake interval
+            void set_duty_cycle(bool duty_cycle);
+
+            // milliseconds until the radio wakes for the next window,
+            // the loop can sleep as long, 0 while it is listening
+            uint32_t get_sleep_millis();
+
+            // items too large for one packet that were dropped, since the
+            // host paired, as some of their fragments never arrived.
+            // the others are put together in the buffer and read as usual
+            uint32_t get_incomplete_items(uint8_t host = 0);
+
+            // methods for the hosts paired with the dongle
+            bool is_host_paired(uint8_t host);
+            uint64_t get_host_unique_id(uint8_t host);
+            uint8_t get_host_count();
+        #endif // NRF_LINK_DONGLE
+
+    private:
+        Radio &radio;
+        bool enabled = false;
+        bool paired = false;
+        uint64_t address;
+        uint64_t unique_id;
+        uint64_t program_id;
+        uint8_t channel;
+        uint8_t data_rate;
+        uint8_t power_level;
+        uint8_t retry_delay;
+        uint8_t retry_count;
+        // largest data packet the host sends, set by the host when pairing
+        uint8_t payload_size;
+        elapsedMillis ping_timer;
+        elapsedMillis pair_timer;
+        uint16_t ping_interval_millis;
+        uint32_t pair_timeout_millis;
+        // data rate and PA level in use, see get_data_rate()
+        uint8_t link_rate;
+        uint8_t link_power;
+
+        bool apply_data_rate(uint8_t rate);
+        void apply_power_level(uint8_t level);
+
+        void run_update();
+
+        #ifdef NRF_STATS
+            // minimums start at UINT32_MAX, averages are filled in by get_stats()
+            NRFStats stats;
+            uint32_t ping_rtts = 0;
+            uint64_t ping_rtt_total_micros = 0;
+            uint64_t update_total_micros = 0;
+
+            void time_update(uint32_t micros_taken);
+        #endif // NRF_STATS
+        #if defined(NRF_STATS) || defined(NRF_PACKET_TIMESTAMP)
+            void time_ping(uint32_t micros_taken);
+        #endif // NRF_STATS || NRF_PACKET_TIMESTAMP
+
+        #ifdef NRF_LINK_HOST
+            NRFQueue<TData, max_packets> buffer;
+            CircularBuffer<TReply, max_replies> reply_buffer;
+            uint16_t burst_budget_micros = 0;
+            uint8_t max_items_per_packet = 0;
+            // sequence number of the next packet, if NRF_PACKET_SEQUENCE is defined
+            uint8_t sequence = 0;
+            // a TData sent in fragments leaves the queue with its first one,
+            // the next fragment of it (0 for none) and its message number
+            TData fragmenting;
+            uint8_t fragment = 0;
+            uint8_t message = 0;
+            // pings back off up to max_ping_interval_millis, see
+            // set_max_ping_interval(), ping_interval_millis is the least
+            uint16_t max_ping_interval_millis = 0;
+            uint16_t keepalive_millis;
+            // wake windows, see set_wake_interval(), the interval in use
+            // since pairing and the time since the last acknowledged frame
+            uint16_t wake_interval_millis = 0;
+            uint16_t link_wake_millis = 0;
+            elapsedMillis wake_timer;
+            // delta encoding, see set_delta(), the delta packets left
+            // until the next keyframe and the last item given to the radio
+            uint8_t delta_keyframes = 0;
+            uint8_t delta_left = 0;
+            TData reference;
+            #ifdef NRF_PACKET_TIMESTAMP
+                // micros() at send() of each queued item, in step with
+                // buffer, and of the item being sent in fragments
+                NRFQueue<uint32_t, max_packets> sent;
+                uint32_t fragmenting_sent = 0;
+                // shortest ping round trip since pairing, pings carry half
+                uint32_t ping_rtt_min = UINT32_MAX;
+            #endif // NRF_PACKET_TIMESTAMP
+
+            // adaptive link, packets, retransmits and lost packets
+            // in the current window, and the clean windows in a row
+            bool adaptive = false;
+            uint8_t adapt_packets = 0;
+            uint16_t adapt_retries = 0;
+            uint8_t adapt_lost = 0;
+            uint8_t adapt_clean = 0;
+            uint8_t adapt_holdoff = _ADAPT_HOLDOFF_MIN_;
+            // channel migration, see set_migration_threshold()
+            uint8_t migrate_percent = 0;
+            uint8_t migrate_wait = 0;
+            // channel proposed when pairing, 0 until scanned, then kept
+            // for the next pairings (see rescan()), and the scan for it
+            // so far, the channels done and the quietest of them
+            uint8_t proposed_channel = 0;
+            uint8_t scan_index = 0;
+            uint8_t scan_best = 0;
+            uint8_t scan_best_busy = 0xFF;
+            // looking for a lost dongle, see set_reconnect_grace()
+            bool reconnecting = false;
+            uint16_t reconnect_grace_millis = _RECONNECT_GRACE_MILLIS_;
+            uint8_t reconnect_backoff_millis = _RECONNECT_BACKOFF_MIN_MILLIS_;
+            elapsedMillis reconnect_timer;
+            elapsedMillis attempt_timer;
+            // pairing backoff, see pair_tried(), with its own random numbers
+            // so hosts that boot together draw different waits
+            uint8_t pair_backoff_millis = _PAIR_BACKOFF_MIN_MILLIS_;
+            uint8_t pair_wait_millis = 0;
+            uint8_t pair_quick_tries = 0;
+            uint32_t random_state = 1;
+            elapsedMillis pair_attempt_timer;
+            // non-blocking mode, see set_update_budget(), the packet in flight
+            // and what to do with it once it is done
+            uint16_t update_budget_micros = 0;
+            uint8_t frame_kind = _FRAME_NONE_;
+            uint8_t frame_items = 0;
+            uint8_t frame_payload_size = 0;
+            bool frame_delivered = false;
+            uint32_t frame_start_micros = 0;
+            SendCallback send_callback = nullptr;
+            void *send_context = nullptr;
+            #ifdef NRF_PACKET_SEQUENCE
+                // reliable mode, the data packets not acknowledged yet
+                // oldest first, and how many of them are with the radio
+                bool reliable = false;
+                NRFRing<Packet<TData>, _RELIABLE_WINDOW_, _QUEUE_REJECT_> window;
+                uint8_t window_sent = 0;
+            #endif // NRF_PACKET_SEQUENCE
+
+            uint8_t fill_packet(Packet<TData> &packet);
+            uint8_t fill_delta(Packet<TData> &packet);
+            TData shift_item();
+            uint8_t build_ping(Packet<TData> &ping_packet);
+            bool has_packet();
+            uint8_t load_packet(Packet<TData> &packet);
+            void confirm_packets(uint8_t count);
+            uint8_t resend_packets(uint8_t items);
+            void report_lost(uint8_t items);
+            uint8_t expected_sequence();
+            bool send_buffered();
+            bool send_burst();
+            bool wake_due();
+            bool ping_now();
+            bool write_frame(uint8_t *bytes, uint8_t size);
+            void start_frame(uint8_t *bytes, uint8_t size, uint8_t kind);
+            void start_ping(uint8_t kind);
+            bool poll_frame(bool &delivered);
+            void abort_frame();
+            bool start_next();
+            void finish_frame(bool delivered);
+            void update_async();
+            void read_replies();
+            bool try_pair();
+            void build_pairing_packet(PairingPacket &pairing_packet);
+            bool accept_pairing(uint8_t payload_size);
+            void observe(bool delivered);
+            void step_down();
+            void step_up();
+            bool migrate();
+            uint8_t quietest_channel(uint8_t first, uint8_t count, uint8_t step);
+            uint8_t channel_busy(uint8_t channel);
+            void scan_step();
+            bool change_link(uint8_t code, uint8_t value);
+            bool apply_link(uint8_t code, uint8_t value);
+            bool recover();
+            bool recover_power();
+            bool recover_rate();
+            void lose_dongle();
+            bool reconnect();
+            bool reconnect_due();
+            void reconnect_tried(bool found);
+            bool pair_due();
+            void pair_tried(bool acked);
+            void reset_pair_backoff();
+            uint32_t next_random();
+            void apply_retries();
+            void reset_link();
+        #endif // NRF_LINK_HOST
+
+        #ifdef NRF_LINK_DONGLE
+            // a host paired (or pairing) with the dongle, on reading pipe slot + 1
+            struct Host {
+                uint8_t state = _HOST_FREE_;
+                uint64_t unique_id = 0;
+                uint16_t ping_interval_millis = 0;
+                // the host looks for us this long after losing us
+                uint16_t grace_millis = 0;
+                // its wake interval, 0 if it sends whenever it wants
+                uint16_t wake_interval_millis = 0;
+                elapsedMillis ping_timer;
+                // reply packets waiting in the radio for an ACK to this host
+                uint8_t loaded_replies = 0;
+                // number of the last data packet, once the host sent one
+                bool sequenced = false;
+                uint8_t last_sequence = 0;
+                uint32_t missed_packets = 0;
+                // the item being put together from fragments in the buffer's
+                // free slot, its message number and the next fragment's index
+                bool assembling = false;
+                uint8_t message = 0;
+                uint8_t fragment = 0;
+                uint32_t incomplete_items = 0;
+                // the last item, which the next delta encoded one builds on
+                bool referenced = false;
+                TData reference;
+                NRFRing<TData, max_packets> buffer;
+                CircularBuffer<TReply, max_replies> reply_buffer;
+                #ifdef NRF_PACKET_TIMESTAMP
+                    // our micros() minus the host's plus the time a packet
+                    // took, the smallest seen in this clock window and in
+                    // the one before, and the time a packet takes as the
+                    // host last told us (half its shortest ping round trip)
+                    bool clocked = false;
+                    uint32_t window_offset = 0;
+                    uint32_t previous_offset = 0;
+                    elapsedMillis clock_timer;
+                    uint32_t ping_delay_micros = 0;
+                    // when the items of the packet being handled were sent,
+                    // by our clock, and their latency
+                    uint32_t item_sent = 0;
+                    uint32_t item_latency = 0;
+                    // latency of the last data packet, for the jitter
+                    bool timed = false;
+                    uint32_t last_latency = 0;
+                    // when each item in the buffer was sent, in step with it
+                    NRFRing<uint32_t, max_packets> sent;
+                #endif // NRF_PACKET_TIMESTAMP
+            };
+            Host hosts[NRF_MAX_HOSTS];
+            uint8_t overflow_policy = _QUEUE_DROP_OLDEST_;
+            // next host read() looks at
+            uint8_t read_host = 0;
+            // on the pairing channel while hosts are paired
+            bool pair_window = false;
+            elapsedMillis window_timer;
+            // host of the pairing accept waiting in the radio for an ACK,
+            // NRF_MAX_HOSTS if none is loaded
+            uint8_t loaded_accept = NRF_MAX_HOSTS;
+            // duty cycle, see set_duty_cycle()
+            bool duty_cycle = false;
+            bool asleep = false;
+            elapsedMillis sleep_timer;
+            #ifdef NRF_PACKET_TIMESTAMP
+                NRFLatency latency = {};
+                // when the last item read was sent, by our clock
+                uint32_t read_sent = 0;
+            #endif // NRF_PACKET_TIMESTAMP
+
+            // a packet as read from the radio
+            struct Frame {
+                uint8_t pipe;
+                // a size of 0 means it was corrupt
+                uint8_t size;
+                Packet<TData> packet;
+                #ifdef NRF_PACKET_TIMESTAMP
+                    // micros() when it was read from the radio
+                    uint32_t micros_received;
+                #endif // NRF_PACKET_TIMESTAMP
+            };
+
+            #ifdef NRF_LINK_IRQ
+                // filled by irq(), emptied by update() and read()
+                NRFRing<Frame, NRF_IRQ_FRAMES, _QUEUE_DROP_NEWEST_> frames;
+            #endif // NRF_LINK_IRQ
+
+            bool receive();
+            bool read_frame(Frame &frame);
+            bool frame_waiting();
+            void handle_frame(const Frame &frame);
+            bool follow_sequence(Host &host, const Packet<TData> &packet);
+            void assemble(Host &host, const Packet<TData> &packet, uint8_t size);
+            void apply_delta(Host &host, const Packet<TData> &packet, uint8_t size);
+            void commit_item(Host &host);
+            #ifdef NRF_PACKET_TIMESTAMP
+                void sync_clock(Host &host, const Frame &frame);
+                uint32_t clock_offset(const Host &host);
+                void time_packet(Host &host);
+            #endif // NRF_PACKET_TIMESTAMP
+            uint8_t accept_host(const PairingPacket &pairing_packet);
+            void load_accept(uint8_t first, uint8_t skip);
+            void free_host(uint8_t host);
+            void expire_hosts();
+            void update_pair_window();
+            void update_sleep();
+            void wake();
+            void end_pair_window();
+            bool has_hosts();
+            bool has_room();
+            uint8_t loaded_replies();
+            void load_replies();
+            uint64_t pipe_address(uint8_t pipe);
+        #endif // NRF_LINK_DONGLE
+
+        typename Backend::Pins pins;
+};
+
+// Implementation
+
+// Constructor
+template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> NRFDongle<Backend, TData, max_packets, TReply, max_replies>::NRFDongle(Radio &radio, uint64_t unique_id, uint64_t program_id, uint16_t ping_interval_millis, uint32_t pair_timeout_millis, uint8_t data_rate, uint8_t power_level, uint8_t retry_delay, uint8_t retry_count, uint8_t ce_pin, uint8_t csn_pin, uint8_t rx_pin, uint8_t sck_pin, uint8_t tx_pin) : radio(radio), pins(ce_pin, csn_pin, rx_pin, sck_pin, tx_pin) {
+
+    // US law restricts the use of the 2.4 GHz band
+    // specifically, frequencies between 2.4-2.473 GHz
+    // are generally allowed.
+    // This corresponds to nRF channels 0-73
+    // (https://github.com/mysensors/MySensors/blob/ee91d5da38a1435cb4b55476447e763f52540c3c/MyConfig.h#L455)
+    // 0 -> 2400 MHz
+    // 1 -> 2401 MHz
+    // n -> 2400 + n MHz
+    // Channel 0 is reserved for pairing (not yet implemented)
+    // https://en.wikipedia.org/wiki/List_of_WLAN_channels
+
+    // the channel is proposed by the first host to pair with the dongle,
+    // the quietest it hears, starting from (unique_id % 73) + 1,
+    // so the channel will be between 1 and 73
+    // since 0 is reserved for pairing
+    // while paired, hosts can move the dongle to a quieter channel
+
+    // the dongle gives each host its address and the channel when pairing,
+    // the addresses share the upper 4 bytes of the first host's unique_id
+    // if this is the dongle, the unique_id is unused
+
+    // set enabled in the constructor to prevent powerup sequence on first begin
+    this->enabled = true;
+
+    // for now, since we need to pair, the addres is _PAIR_ADDRESS_
+    this->address = _PAIR_ADDRESS_;
+    this->paired = false;
+
+    // set the unique_id, which will be used later
+    this->unique_id = unique_id;
+
+    // set the program_id, which must match the program_id of the host
+    this->program_id = program_id;
+
+    // set the channel to the pairing channel
+    this->channel = _PAIR_CHANNEL_;
+
+    // set the ping interval
+    this->ping_interval_millis = ping_interval_millis;
+    #ifdef NRF_LINK_HOST
+        this->keepalive_millis = ping_interval_millis;
+        // the pairing backoff is drawn from the unique_id, never 0
+        this->random_state = (uint32_t)(unique_id ^ (unique_id >> 32)) | 1;
+    #endif // NRF_LINK_HOST
+
+    // set the pair timeout
+    this->pair_timeout_millis = pair_timeout_millis;
+
+    // save radio settings
+    this->data_rate = data_rate;
+    this->power_level = power_level;
+    this->retry_delay = retry_delay;
+    this->retry_count = retry_count;
+    this->link_rate = data_rate;
+    this->link_power = power_level;
+
+    // until paired, assume one item per packet
+    this->payload_size = Packet<TData>::size(1);
+
+    // start counting from here
+    this->reset_stats();
+}
+
+// Begin
+template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::begin() {
+
+    if (!this->enabled){
+        this->enabled = true;
+        this->radio.powerUp();
+    }
+
+    Backend::begin(this->radio, this->pins);
+
+    this->channel = _PAIR_CHANNEL_;
+    this->address = _PAIR_ADDRESS_;
+    this->paired = false;
+    #ifdef NRF_LINK_HOST
+        this->reconnecting = false;
+        this->abort_frame();
+        this->report_lost(this->resend_packets(0));
+        this->reset_pair_backoff();
+    #endif // NRF_LINK_HOST
+
+    // set the channel
+    this->radio.setChannel(channel);
+
+    // apply settings
+    this->link_rate = this->data_rate;
+    this->link_power = this->power_level;
+    this->apply_data_rate(this->link_rate);
+    this->apply_power_level(this->link_power);
+    this->radio.setRetries(this->retry_delay, this->retry_count);
+
+    // packets are only as long as their contents,
+    // and the dongle's replies ride on the ACKs
+    this->radio.enableDynamicPayloads();
+    this->radio.enableAckPayload();
+
+    // only received packets pull the IRQ pin low,
+    // not the ACK payloads going out
+    #ifdef NRF_LINK_IRQ
+        Backend::mask_irq(this->radio);
+    #endif // NRF_LINK_IRQ
+
+    // host opens writing pipe
+    // dongle opens reading pipe
+    #ifdef NRF_LINK_HOST
+        this->radio.openWritingPipe(this->address);
+    #endif // NRF_LINK_HOST
+    #ifdef NRF_LINK_DONGLE
+        // pairing packets arrive on pipe 0, so the accepts can ride on its ACKs,
+        // hosts are on pipes 1-5
+        this->radio.openReadingPipe(0, this->address);
+        for (uint8_t i = 0; i < NRF_MAX_HOSTS; i++) {
+            this->free_host(i);
+        }
+        this->asleep = false;
+        this->pair_window = false;
+        this->loaded_accept = NRF_MAX_HOSTS;
+    #endif // NRF_LINK_DONGLE
+
+    // start listening on the dongle
+    #ifdef NRF_LINK_HOST
+        this->radio.stopListening();
+    #endif // NRF_LINK_HOST
+    #ifdef NRF_LINK_DONGLE
+        this->radio.startListening();
+    #endif // NRF_LINK_DONGLE
+
+    // start timers
+    this->ping_timer = 0;
+    this->pair_timer = 0;
+}
+
+// Begin (Record)
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::begin(const PairingRecord &record) {
+        this->begin();
+
+        if (record.program_id != this->program_id || record.unique_id != this->unique_id) {
+            return false;
+        }
+
+        if (record.channel < 1 || record.channel > _CHANNEL_COUNT_ || record.payload_size < Packet<TData>::size(1) || record.payload_size > 32) {
+            return false;
+        }
+
+        // take the session back as if we had just lost the dongle,
+        // the first try is right away
+        this->paired = true;
+        this->address = record.address;
+        this->channel = record.channel;
+        this->payload_size = record.payload_size;
+        this->radio.setChannel(this->channel);
+        this->radio.openWritingPipe(this->address);
+        this->radio.stopListening();
+        if (this->adaptive) {
+            this->apply_retries();
+        }
+        // the session was paired with the same wake interval
+        this->link_wake_millis = this->wake_interval_millis;
+
+        this->reconnecting = true;
+        this->reconnect_timer = 0;
+        this->reconnect_backoff_millis = _RECONNECT_BACKOFF_MIN_MILLIS_;
+        this->attempt_timer = _RECONNECT_BACKOFF_MIN_MILLIS_;
+        return true;
+    }
+#endif // NRF_LINK_HOST
+
+// Get Pairing Record
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::get_pairing_record(PairingRecord &record) {
+        if (!this->paired) {
+            return false;
+        }
+
+        record.program_id = this->program_id;
+        record.unique_id = this->unique_id;
+        record.address = this->address;
+        record.channel = this->channel;
+        record.payload_size = this->payload_size;
+        return true;
+    }
+#endif // NRF_LINK_HOST
+
+// Is Connected
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::is_connected() {
+        return this->paired && !this->reconnecting;
+    }
+#endif // NRF_LINK_HOST
+
+// Set Reconnect Grace
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::set_reconnect_grace(uint16_t grace_millis) {
+        this->reconnect_grace_millis = grace_millis;
+    }
+#endif // NRF_LINK_HOST
+
+// Lose Dongle
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::lose_dongle() {
+        // without a grace period, pair again straight away
+        if (this->reconnect_grace_millis == 0) {
+            this->unpair();
+            uint8_t lost = this->buffer.size();
+            #ifdef NRF_PACKET_SEQUENCE
+                for (uint8_t i = 0; i < this->window.size(); i++) {
+                    lost += this->window[i].items();
+                }
+            #endif // NRF_PACKET_SEQUENCE
+            this->report_lost(lost);
+            this->buffer.clear();
+            #ifdef NRF_PACKET_TIMESTAMP
+                this->sent.clear();
+            #endif // NRF_PACKET_TIMESTAMP
+            this->fragment = 0;
+            this->delta_left = 0;
+            #ifdef NRF_PACKET_SEQUENCE
+                this->window.clear();
+            #endif // NRF_PACKET_SEQUENCE
+            return;
+        }
+
+        // keep the session and the queue, and look for the dongle
+        // on its channel in the next updates
+        this->reconnecting = true;
+        this->reconnect_timer = 0;
+        this->attempt_timer = 0;
+        this->reconnect_backoff_millis = _RECONNECT_BACKOFF_MIN_MILLIS_;
+    }
+#endif // NRF_LINK_HOST
+
+// Reconnect
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::reconnect() {
+        // returns true once the dongle answers again
+        if (!this->reconnect_due()) {
+            return false;
+        }
+
+        bool found = this->adaptive ? this->recover() : this->ping_now();
+        this->reconnect_tried(found);
+        return found;
+    }
+#endif // NRF_LINK_HOST
+
+// Reconnect Due
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::reconnect_due() {
+        // returns true if it is time to try again
+
+        // it has been gone for too long, pair again,
+        // the queue waits for the new session
+        if (this->reconnect_timer > this->reconnect_grace_millis) {
+            this->unpair();
+            return false;
+        }
+
+        // every try takes all the retries, so back off between them
+        if (this->attempt_timer < this->reconnect_backoff_millis) {
+            return false;
+        }
+        this->attempt_timer = 0;
+        return true;
+    }
+#endif // NRF_LINK_HOST
+
+// Reconnect Tried
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::reconnect_tried(bool found) {
+        if (!found) {
+            if (this->reconnect_backoff_millis < _RECONNECT_BACKOFF_MAX_MILLIS_) {
+                this->reconnect_backoff_millis *= 2;
+            }
+            return;
+        }
+
+        this->reconnecting = false;
+        this->ping_timer = 0;
+        NRF_STATS_ADD(reconnects, 1);
+    }
+#endif // NRF_LINK_HOST
+
+// Pair Due
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::pair_due() {
+        // returns true if it is time to send the next pairing packet
+        return this->pair_attempt_timer >= this->pair_wait_millis;
+    }
+#endif // NRF_LINK_HOST
+
+// Pair Tried
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::pair_tried(bool acked) {
+        // a pairing packet went out and we were not accepted (yet),
+        // the wait starts now, after all the retries it took
+        this->pair_attempt_timer = 0;
+
+        // the dongle heard us, our accept rides on the ACK of a later
+        // pairing packet, so try again at once, while its window is open
+        if (acked && this->pair_quick_tries < _PAIR_QUICK_TRIES_) {
+            this->pair_quick_tries++;
+            this->pair_backoff_millis = _PAIR_BACKOFF_MIN_MILLIS_;
+            this->pair_wait_millis = 0;
+            return;
+        }
+
+        // nobody heard us, most likely another host sent at the same time
+        // or the dongle is off the pairing channel, and a dongle that keeps
+        // answering without accepting us (another program_id, or no room)
+        // is no better, so wait a random time in a window that doubles
+        if (!acked) {
+            this->pair_quick_tries = 0;
+        }
+        this->pair_wait_millis = 1 + this->next_random() % this->pair_backoff_millis;
+        if (this->pair_backoff_millis < _PAIR_BACKOFF_MAX_MILLIS_) {
+            this->pair_backoff_millis *= 2;
+        }
+    }
+#endif // NRF_LINK_HOST
+
+// Reset Pair Backoff
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::reset_pair_backoff() {
+        // the next pairing packet goes out straight away
+        this->pair_backoff_millis = _PAIR_BACKOFF_MIN_MILLIS_;
+        this->pair_wait_millis = 0;
+        this->pair_quick_tries = 0;
+    }
+#endif // NRF_LINK_HOST
+
+// Next Random
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> uint32_t NRFDongle<Backend, TData, max_packets, TReply, max_replies>::next_random() {
+        // xorshift32, enough to keep hosts from backing off in step
+        this->random_state ^= this->random_state << 13;
+        this->random_state ^= this->random_state >> 17;
+        this->random_state ^= this->random_state << 5;
+        return this->random_state;
+    }
+#endif // NRF_LINK_HOST
+
+// Update
+template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::update() {
+    #ifdef NRF_STATS
+        uint32_t start = micros();
+        this->run_update();
+        this->time_update((uint32_t)(micros() - start));
+    #else
+        this->run_update();
+    #endif // NRF_STATS
+}
+
+// Run Update
+template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::run_update() {
+
+    if (!this->enabled){
+        return;
+    }
+
+    // if we are the host, we can send packets
+    #ifdef NRF_LINK_HOST
+        // a packet in flight is finished the same way after switching back
+        if (this->update_budget_micros > 0 || this->frame_kind != _FRAME_NONE_) {
+            this->update_async();
+            return;
+        }
+
+        // if we are not paired, try to pair
+        if (!this->paired) {
+            this->paired = this->try_pair();
+
+            // if we are not paired, and the pair timeout has exceeded
+            // then power down the radio
+            // unless the timeout is disabled (pair_timeout_millis = 0)
+            if (this->pair_timeout_millis > 0 && !this->paired && this->pair_timer > this->pair_timeout_millis) {
+                this->end();
+            }
+        }
+
+        // if we are paired, we can send packets and ping
+        else {
+
+            // the dongle was lost, look for it before sending again
+            if (this->reconnecting && !this->reconnect()) {
+                return;
+            }
+
+            // data and pings wait for the dongle to listen
+            if (!this->wake_due()) {
+                return;
+            }
+
+            // if we have packets to send
+            if (this->has_packet()) {
+                // send a packet with as many items as fit, popping them
+                // or in burst mode, as many packets as the budget allows,
+                // the fragments of a large TData always go out as a burst
+                bool received;
+                if (this->burst_budget_micros > 0 || Packet<TData>::fragmented) {
+                    received = this->send_burst();
+                } else {
+                    received = this->send_buffered();
+                }
+
+                // if the packet was not received, and the dongle can not
+                // be found again, keep looking for it in the next updates
+                if (!received && !this->recover()) {
+                    this->lose_dongle();
+                    return;
+                } else {
+                    // reset the ping timer as there's no need to ping
+                    // if data was sent and received
+                    this->ping_timer = 0;
+                }
+
+            }
+
+            // try to ping
+            // if data was just sent, then this will be skipped safely
+            if (!this->ping() && !this->recover()) {
+                // if the ping was sent and not acknowledged, look for the dongle
+                this->lose_dongle();
+            }
+        }
+    #endif // NRF_LINK_HOST
+
+    // if we are the dongle, we can receive packets
+    #ifdef NRF_LINK_DONGLE
+        // drop hosts that stopped pinging, or never finished pairing
+        this->expire_hosts();
+
+        // if no host is paired or pairing, wait on the pairing channel
+        if (!this->has_hosts()) {
+            this->wake();
+            while (this->receive());
+
+            // if we are not paired, and the pair timeout has exceeded
+            // then power down the radio
+            // unless the timeout is disabled (pair_timeout_millis = 0)
+            if (this->pair_timeout_millis > 0 && !this->has_hosts() && this->pair_timer > this->pair_timeout_millis) {
+                this->end();
+            }
+        } else {
+            // hop to the pairing channel now and then for new hosts
+            this->update_pair_window();
+
+            // empty the RX FIFO, packets from the hosts and pairing packets
+            while (this->receive());
+
+            // keep replies loaded for the next ACKs
+            this->load_replies();
+
+            // power down between the hosts' wake windows
+            this->update_sleep();
+        }
+    #endif // NRF_LINK_DONGLE
+}
+
+// End
+template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::end() {
+    if (this->enabled){
+        this->enabled = false;
+        #ifdef NRF_LINK_HOST
+            this->abort_frame();
+        #endif // NRF_LINK_HOST
+        this->radio.powerDown();
+    }
+}
+
+// Unpair
+template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::unpair() {
+    if (!this->enabled){
+        return false;
+    }
+
+    #ifdef NRF_LINK_HOST
+        if (!this->paired){
+            return true;
+        }
+    #endif // NRF_LINK_HOST
+    #ifdef NRF_LINK_DONGLE
+        if (!this->has_hosts()){
+            return true;
+        }
+    #endif // NRF_LINK_DONGLE
+
+    this->paired = false;
+    this->address = _PAIR_ADDRESS_;
+    this->channel = _PAIR_CHANNEL_;
+
+    // set the channel
+    this->radio.setChannel(channel);
+
+    // pairing is at the constructor's data rate and PA level
+    #ifdef NRF_LINK_HOST
+        NRF_STATS_ADD(unpairs, 1);
+        this->abort_frame();
+        this->report_lost(this->resend_packets(0));
+        this->reset_link();
+        this->reconnecting = false;
+        this->reset_pair_backoff();
+    #endif // NRF_LINK_HOST
+
+    // drop every host, and replies still waiting for an ACK
+    #ifdef NRF_LINK_DONGLE
+        this->wake();
+        this->radio.flush_tx();
+        for (uint8_t i = 0; i < NRF_MAX_HOSTS; i++) {
+            this->free_host(i);
+            this->hosts[i].reply_buffer.clear();
+        }
+        this->pair_window = false;
+        this->loaded_accept = NRF_MAX_HOSTS;
+    #endif // NRF_LINK_DONGLE
+
+    // host opens writing pipe
+    // dongle listens on the pairing pipe
+    #ifdef NRF_LINK_HOST
+        this->radio.openWritingPipe(this->address);
+    #endif // NRF_LINK_HOST
+    #ifdef NRF_LINK_DONGLE
+        this->radio.openReadingPipe(0, this->address);
+    #endif // NRF_LINK_DONGLE
+
+    // start listening on the dongle
+    #ifdef NRF_LINK_HOST
+        this->radio.stopListening();
+    #endif // NRF_LINK_HOST
+    #ifdef NRF_LINK_DONGLE
+        this->radio.startListening();
+    #endif // NRF_LINK_DONGLE
+
+    // reset timers
+    this->ping_timer = 0;
+    this->pair_timer = 0;
+
+    return true;
+}
+
+// Is Paired
+template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::is_paired() {
+    return this->paired;
+}
+
+// Is Enabled
+template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::is_enabled() {
+    return this->enabled;
+}
+
+// Get Address
+template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> uint64_t NRFDongle<Backend, TData, max_packets, TReply, max_replies>::get_address() {
+    return this->address;
+}
+
+// Get Unique ID
+template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> uint64_t NRFDongle<Backend, TData, max_packets, TReply, max_replies>::get_unique_id() {
+    return this->unique_id;
+}
+
+// Get Program ID
+template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> uint64_t NRFDongle<Backend, TData, max_packets, TReply, max_replies>::get_program_id() {
+    return this->program_id;
+}
+
+// Get Channel
+template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> uint8_t NRFDongle<Backend, TData, max_packets, TReply, max_replies>::get_channel() {
+    return this->channel;
+}
+
+// Set Unique ID
+template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::set_unique_id(uint64_t unique_id) {
+    this->unique_id = unique_id;
+}
+
+// Set Overflow Policy
+template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::set_overflow_policy(uint8_t policy) {
+    #ifdef NRF_LINK_HOST
+        this->buffer.set_overflow_policy(policy);
+        #ifdef NRF_PACKET_TIMESTAMP
+            this->sent.set_overflow_policy(policy);
+        #endif // NRF_PACKET_TIMESTAMP
+    #endif // NRF_LINK_HOST
+    #ifdef NRF_LINK_DONGLE
+        this->overflow_policy = policy;
+        for (uint8_t i = 0; i < NRF_MAX_HOSTS; i++) {
+            this->hosts[i].buffer.set_overflow_policy(policy);
+            #ifdef NRF_PACKET_TIMESTAMP
+                this->hosts[i].sent.set_overflow_policy(policy);
+            #endif // NRF_PACKET_TIMESTAMP
+        }
+    #endif // NRF_LINK_DONGLE
+}
+
+// Get Data Rate
+template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> uint8_t NRFDongle<Backend, TData, max_packets, TReply, max_replies>::get_data_rate() {
+    return this->link_rate;
+}
+
+// Get Power Level
+template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> uint8_t NRFDongle<Backend, TData, max_packets, TReply, max_replies>::get_power_level() {
+    return this->link_power;
+}
+
+// Apply Data Rate
+template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::apply_data_rate(uint8_t rate) {
+    return Backend::set_data_rate(this->radio, rate);
+}
+
+// Apply Power Level
+template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::apply_power_level(uint8_t level) {
+    Backend::set_power_level(this->radio, level);
+}
+
+// Has Data
+template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::has_data() {
+    #ifdef NRF_LINK_HOST
+        return !this->buffer.isEmpty();
+    #endif // NRF_LINK_HOST
+    #ifdef NRF_LINK_DONGLE
+        for (uint8_t i = 0; i < NRF_MAX_HOSTS; i++) {
+            if (this->hosts[i].state == _HOST_PAIRED_ && !this->hosts[i].buffer.isEmpty()) {
+                return true;
+            }
+        }
+        return false;
+    #endif // NRF_LINK_DONGLE
+}
+
+// Get Radio
+template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> typename NRFDongle<Backend, TData, max_packets, TReply, max_replies>::Radio &NRFDongle<Backend, TData, max_packets, TReply, max_replies>::get_radio() {
+    return this->radio;
+}
+
+// Get Stats
+template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> NRFStats NRFDongle<Backend, TData, max_packets, TReply, max_replies>::get_stats() {
+    NRFStats stats;
+    memset(&stats, 0, sizeof(stats));
+
+    #ifdef NRF_STATS
+        stats = this->stats;
+
+        // the high-water marks are kept by the buffers themselves
+        #ifdef NRF_LINK_HOST
+            stats.queue_high_water = this->buffer.high_water_mark();
+        #endif // NRF_LINK_HOST
+        #ifdef NRF_LINK_DONGLE
+            for (uint8_t i = 0; i < NRF_MAX_HOSTS; i++) {
+                if (this->hosts[i].buffer.high_water_mark() > stats.queue_high_water) {
+                    stats.queue_high_water = this->hosts[i].buffer.high_water_mark();
+                }
+            }
+
+            // and the radio may be asleep right now
+            if (this->asleep) {
+                stats.sleep_millis += this->sleep_timer;
+            }
+        #endif // NRF_LINK_DONGLE
+
+        if (this->ping_rtts > 0) {
+            stats.ping_rtt_avg_micros = (uint32_t)(this->ping_rtt_total_micros / this->ping_rtts);
+        } else {
+            stats.ping_rtt_min_micros = 0;
+        }
+        if (stats.updates > 0) {
+            stats.update_avg_micros = (uint32_t)(this->update_total_micros / stats.updates);
+        } else {
+            stats.update_min_micros = 0;
+        }
+    #endif // NRF_STATS
+
+    return stats;
+}
+
+// Reset Stats
+template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::reset_stats() {
+    #ifdef NRF_STATS
+        memset(&this->stats, 0, sizeof(this->stats));
+        this->stats.ping_rtt_min_micros = UINT32_MAX;
+        this->stats.update_min_micros = UINT32_MAX;
+        this->ping_rtts = 0;
+        this->ping_rtt_total_micros = 0;
+        this->update_total_micros = 0;
+    #endif // NRF_STATS
+
+    #ifdef NRF_LINK_HOST
+        this->buffer.reset_high_water_mark();
+    #endif // NRF_LINK_HOST
+    #ifdef NRF_LINK_DONGLE
+        for (uint8_t i = 0; i < NRF_MAX_HOSTS; i++) {
+            this->hosts[i].buffer.reset_high_water_mark();
+        }
+        // time asleep is counted from here too
+        this->sleep_timer = 0;
+    #endif // NRF_LINK_DONGLE
+}
+
+// Time Ping
+#if defined(NRF_STATS) || defined(NRF_PACKET_TIMESTAMP)
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::time_ping(uint32_t micros_taken) {
+        #ifdef NRF_STATS
+            this->ping_rtts++;
+            this->ping_rtt_total_micros += micros_taken;
+            if (micros_taken < this->stats.ping_rtt_min_micros) {
+                this->stats.ping_rtt_min_micros = micros_taken;
+            }
+            if (micros_taken > this->stats.ping_rtt_max_micros) {
+                this->stats.ping_rtt_max_micros = micros_taken;
+            }
+        #endif // NRF_STATS
+
+        #if defined(NRF_PACKET_TIMESTAMP) && defined(NRF_LINK_HOST)
+            if (micros_taken < this->ping_rtt_min) {
+                this->ping_rtt_min = micros_taken;
+            }
+        #endif // NRF_PACKET_TIMESTAMP && NRF_LINK_HOST
+    }
+#endif // NRF_STATS || NRF_PACKET_TIMESTAMP
+
+// Time Update
+#ifdef NRF_STATS
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::time_update(uint32_t micros_taken) {
+        this->stats.updates++;
+        this->update_total_micros += micros_taken;
+        if (micros_taken < this->stats.update_min_micros) {
+            this->stats.update_min_micros = micros_taken;
+        }
+        if (micros_taken > this->stats.update_max_micros) {
+            this->stats.update_max_micros = micros_taken;
+        }
+    }
+#endif // NRF_STATS
+
+// Try Pair
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::try_pair() {
+
+        if (!this->enabled){
+            return false;
+        }
+
+        if (this->paired){
+            return true;
+        }
+
+        // hosts that boot together back off, see pair_tried()
+        if (!this->pair_due()) {
+            return false;
+        }
+
+        // we send our unique_id until the dongle accepts us,
+        // the accept comes back on the ACK of a later pairing packet
+        // as the dongle only loads it after reading our first one
+        PairingPacket pairing_packet;
+        this->build_pairing_packet(pairing_packet);
+
+        uint8_t buf[32];
+        pairing_packet.encode(buf);
+        if (!this->write_frame(buf, PairingPacket::size)) {
+            this->pair_tried(false);
+            return false;
+        }
+
+        // an ACK alone does not pair us, the dongle may have refused us
+        if (!this->accept_pairing(pairing_packet.payload_size)) {
+            this->pair_tried(true);
+            return false;
+        }
+        return true;
+    }
+#endif // NRF_LINK_HOST
+
+// Build Pairing Packet
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::build_pairing_packet(PairingPacket &pairing_packet) {
+        // listen over the band for the quietest channel, once,
+        // pairing again proposes the same one (see rescan())
+        while (this->proposed_channel == 0) {
+            this->scan_step();
+        }
+
+        pairing_packet.unique_id = this->unique_id;
+        pairing_packet.program_id = this->program_id;
+        // the dongle waits for pings as far apart as they can grow
+        pairing_packet.ping_interval_millis = this->ping_interval_millis;
+        if (this->max_ping_interval_millis > pairing_packet.ping_interval_millis) {
+            pairing_packet.ping_interval_millis = this->max_ping_interval_millis;
+        }
+        pairing_packet.channel = this->proposed_channel;
+        pairing_packet.reconnect_grace_millis = this->reconnect_grace_millis;
+        pairing_packet.wake_interval_millis = this->wake_interval_millis;
+
+        // the payload size is set by how many items the host packs per packet
+        uint8_t items = Packet<TData>::max_items;
+        if (this->max_items_per_packet > 0 && this->max_items_per_packet < items) {
+            items = this->max_items_per_packet;
+        }
+        pairing_packet.payload_size = Packet<TData>::size(items);
+    }
+#endif // NRF_LINK_HOST
+
+// Accept Pairing
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::accept_pairing(uint8_t payload_size) {
+        // after a pairing packet was acknowledged,
+        // look for an accept meant for us, other hosts may be pairing too
+        uint8_t buf[32];
+        bool accepted = false;
+        PairingAccept accept;
+        while (this->radio.available()) {
+            uint8_t size = this->radio.getDynamicPayloadSize();
+            this->radio.read(buf, size);
+            if (size == PairingAccept::size) {
+                PairingAccept received;
+                received.decode(buf);
+                if (received.unique_id == this->unique_id) {
+                    accept = received;
+                    accepted = true;
+                }
+            }
+        }
+
+        // if we were accepted, we are paired
+        // and we need to switch our channel, address,
+        // and payload size
+        if (accepted) {
+            NRF_STATS_ADD(pairs, 1);
+            this->paired = true;
+            this->address = accept.address;
+            this->channel = accept.channel;
+            this->pair_timer = 0;
+            this->reset_pair_backoff();
+
+            this->radio.setChannel(this->channel);
+            this->payload_size = payload_size;
+            // the dongle has nothing for deltas to build on yet
+            this->delta_left = 0;
+            #ifdef NRF_PACKET_TIMESTAMP
+                // nor for the delay a packet takes
+                this->ping_rtt_min = UINT32_MAX;
+            #endif // NRF_PACKET_TIMESTAMP
+            this->radio.openWritingPipe(this->address);
+            this->radio.stopListening();
+
+            // the adaptive link starts from the pairing settings
+            if (this->adaptive) {
+                this->apply_retries();
+            }
+
+            // the dongle listens until our first packet, windows start there
+            this->link_wake_millis = this->wake_interval_millis;
+            this->keepalive_millis = this->ping_interval_millis;
+
+            // ping right away, the dongle holds our slot until it hears from us
+            this->ping_timer = this->keepalive_millis + 1;
+        }
+        return accepted;
+    }
+#endif // NRF_LINK_HOST
+
+// Send
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::send(TData data, bool send_now, bool priority) {
+        if (!this->enabled){
+            return false;
+        }
+
+        if (!this->paired){
+            return false;
+        }
+
+        // if we are not sending now, queue the data,
+        // also while looking for the dongle, it goes out once it is back
+        // only a rejected item is reported, dropping is what was asked for
+        bool queue = !send_now || this->reconnecting || this->update_budget_micros > 0 || Packet<TData>::fragmented || this->delta_keyframes > 1 || this->link_wake_millis > 0;
+        #ifdef NRF_PACKET_SEQUENCE
+            queue = queue || this->reliable;
+        #endif // NRF_PACKET_SEQUENCE
+        if (queue) {
+            priority = priority || send_now;
+            #ifdef NRF_PACKET_TIMESTAMP
+                this->sent.push(micros(), priority);
+            #endif // NRF_PACKET_TIMESTAMP
+            if (this->buffer.push(data, priority)) {
+                return true;
+            }
+            NRF_STATS_ADD(overflows, 1);
+            return this->buffer.get_overflow_policy() != _QUEUE_REJECT_;
+        }
+
+        // if we are sending now, send the packet
+        Packet<TData> packet;
+        packet.set_header(_PACKET_DATA_, 1, this->sequence++);
+        packet.set(0, data);
+        bool report = this->write_frame(packet.bytes, packet.length());
+        this->observe(report);
+        if (this->send_callback != nullptr) {
+            this->send_callback(report, 1, this->send_context);
+        }
+
+        // if the packet was received, reset the ping timer
+        // and collect any reply that came back on the ACK
+        if (report) {
+            this->ping_timer = 0;
+            this->read_replies();
+        }
+
+        return report;
+    }
+#endif // NRF_LINK_HOST
+
+// Get High Water Mark
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> uint8_t NRFDongle<Backend, TData, max_packets, TReply, max_replies>::get_high_water_mark() {
+        return this->buffer.high_water_mark();
+    }
+#endif // NRF_LINK_HOST
+
+// Reset High Water Mark
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::reset_high_water_mark() {
+        this->buffer.reset_high_water_mark();
+    }
+#endif // NRF_LINK_HOST
+
+// Get Queue Room
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> uint8_t NRFDongle<Backend, TData, max_packets, TReply, max_replies>::get_queue_room() {
+        return this->buffer.room();
+    }
+#endif // NRF_LINK_HOST
+
+// Fill Packet
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> uint8_t NRFDongle<Backend, TData, max_packets, TReply, max_replies>::fill_packet(Packet<TData> &packet) {
+        // the next fragment of the oldest item,
+        // returns 1 once it is the last one
+        if (Packet<TData>::fragmented) {
+            if (this->fragment == 0) {
+                #ifdef NRF_PACKET_TIMESTAMP
+                    this->fragmenting_sent = this->sent.first();
+                #endif // NRF_PACKET_TIMESTAMP
+                this->fragmenting = this->shift_item();
+            }
+            packet.set_fragment(this->message, this->fragment++, this->fragmenting, this->sequence++);
+            #ifdef NRF_PACKET_TIMESTAMP
+                packet.set_timestamp(this->fragmenting_sent);
+            #endif // NRF_PACKET_TIMESTAMP
+            if (this->fragment == Packet<TData>::fragment_count()) {
+                this->fragment = 0;
+                this->message++;
+            }
+            return packet.items();
+        }
+
+        // delta encoded items, with a full packet every delta_keyframes,
+        // never for a fragmented TData, which went out above
+        if (this->delta_keyframes > 1) {
+            if (this->delta_left > 0) {
+                uint8_t count = this->fill_delta(packet);
+                if (count > 0) {
+                    this->delta_left--;
+                    return count;
+                }
+                // the oldest item changed too much, it goes in full
+            } else {
+                this->delta_left = this->delta_keyframes - 1;
+            }
+        }
+
+        // move as many items as fit in the payload from the buffer
+        // into the packet, oldest first so the dongle gets them in order,
+        // NRFMessages up to the next of another type. the payload size
+        // holds the max items per packet of the largest type, smaller
+        // ones are held to it here
+        uint8_t items = Packet<TData>::max_items;
+        if (Packet<TData>::typed && this->max_items_per_packet > 0 && this->max_items_per_packet < items) {
+            items = this->max_items_per_packet;
+        }
+        uint8_t count = 0;
+        #ifdef NRF_PACKET_TIMESTAMP
+            uint32_t sent = this->sent.first();
+        #endif // NRF_PACKET_TIMESTAMP
+        while (count < items && !this->buffer.isEmpty() && packet.room_for(count, this->buffer.first(), this->payload_size)) {
+            packet.set(count, this->shift_item());
+            count++;
+        }
+        packet.set_header(_PACKET_DATA_, count, this->sequence++);
+        #ifdef NRF_PACKET_TIMESTAMP
+            // stamped with when its oldest item was sent
+            if (count > 0) {
+                packet.set_timestamp(sent);
+            }
+        #endif // NRF_PACKET_TIMESTAMP
+
+        // the deltas that follow build on the last item
+        if (this->delta_keyframes > 1 && count > 0) {
+            packet.get(count - 1, this->reference);
+        }
+        return count;
+    }
+#endif // NRF_LINK_HOST
+
+// Fill Delta
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> uint8_t NRFDongle<Backend, TData, max_packets, TReply, max_replies>::fill_delta(Packet<TData> &packet) {
+        // move as many items as fit from the buffer into a delta packet,
+        // each as the bytes that changed from the item before it,
+        // returns 0 (and leaves the buffer alone) if not even one fits
+        uint8_t items = this->max_items_per_packet > 0 ? this->max_items_per_packet : 255;
+        uint8_t offset = Packet<TData>::header_size + 1;
+        uint8_t count = 0;
+        #ifdef NRF_PACKET_TIMESTAMP
+            uint32_t sent = this->sent.first();
+        #endif // NRF_PACKET_TIMESTAMP
+        while (count < items && !this->buffer.isEmpty()) {
+            uint8_t next = packet.put_delta(offset, this->buffer.first(), this->reference);
+            if (next == 0) {
+                break;
+            }
+            this->reference = this->shift_item();
+            offset = next;
+            count++;
+        }
+        if (count == 0) {
+            return 0;
+        }
+
+        packet.set_header(_PACKET_DATA_, 0, this->sequence++);
+        packet.bytes[Packet<TData>::header_size] = count;
+        #ifdef NRF_PACKET_TIMESTAMP
+            packet.set_timestamp(sent);
+        #endif // NRF_PACKET_TIMESTAMP
+        NRF_STATS_ADD(deltas, count);
+        return count;
+    }
+#endif // NRF_LINK_HOST
+
+// Shift Item
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> TData NRFDongle<Backend, TData, max_packets, TReply, max_replies>::shift_item() {
+        // the oldest queued item, and when it was sent with it
+        #ifdef NRF_PACKET_TIMESTAMP
+            this->sent.shift();
+        #endif // NRF_PACKET_TIMESTAMP
+        return this->buffer.shift();
+    }
+#endif // NRF_LINK_HOST
+
+// Build Ping
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> uint8_t NRFDongle<Backend, TData, max_packets, TReply, max_replies>::build_ping(Packet<TData> &ping_packet) {
+        // a ping packet carries no items, returns its payload size
+        ping_packet.set_header(_PACKET_PING_, 0, this->expected_sequence());
+        #ifdef NRF_PACKET_TIMESTAMP
+            // and half our shortest round trip, as the time a packet takes
+            uint32_t delay = this->ping_rtt_min == UINT32_MAX ? 0 : this->ping_rtt_min / 2;
+            nrf_write_le(&ping_packet.bytes[Packet<TData>::header_size], delay > 0xFFFF ? 0xFFFF : delay, 2);
+            return Packet<TData>::size(0) + 2;
+        #else
+            return Packet<TData>::size(0);
+        #endif // NRF_PACKET_TIMESTAMP
+    }
+#endif // NRF_LINK_HOST
+
+// Has Packet
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::has_packet() {
+        // true if there is a data packet to send, new or again
+        bool queued = !this->buffer.isEmpty() || this->fragment > 0;
+        #ifdef NRF_PACKET_SEQUENCE
+            if (this->reliable) {
+                return this->window_sent < this->window.size() || (queued && !this->window.isFull());
+            }
+        #endif // NRF_PACKET_SEQUENCE
+        return queued;
+    }
+#endif // NRF_LINK_HOST
+
+// Load Packet
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> uint8_t NRFDongle<Backend, TData, max_packets, TReply, max_replies>::load_packet(Packet<TData> &packet) {
+        // the next data packet, returns how many items it carries
+        // a reliable host first sends the unacknowledged ones again,
+        // oldest first, and keeps new ones until they are acknowledged
+        #ifdef NRF_PACKET_SEQUENCE
+            if (this->reliable) {
+                if (this->window_sent < this->window.size()) {
+                    packet = this->window[this->window_sent++];
+                    NRF_STATS_ADD(resends, 1);
+                    return packet.items();
+                }
+
+                uint8_t count = this->fill_packet(packet);
+                this->window.push(packet);
+                this->window_sent++;
+                return count;
+            }
+        #endif // NRF_PACKET_SEQUENCE
+        return this->fill_packet(packet);
+    }
+#endif // NRF_LINK_HOST
+
+// Confirm Packets
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::confirm_packets(uint8_t count) {
+        // the oldest count packets given to the radio were acknowledged
+        #ifdef NRF_PACKET_SEQUENCE
+            if (count > this->window_sent) {
+                count = this->window_sent;
+            }
+            this->window.consume(count);
+            this->window_sent -= count;
+        #else
+            (void)count;
+        #endif // NRF_PACKET_SEQUENCE
+    }
+#endif // NRF_LINK_HOST
+
+// Resend Packets
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> uint8_t NRFDongle<Backend, TData, max_packets, TReply, max_replies>::resend_packets(uint8_t items) {
+        // the unacknowledged packets, carrying items, go out again,
+        // from the oldest, so none of their items are lost
+        #ifdef NRF_PACKET_SEQUENCE
+            if (this->reliable) {
+                this->window_sent = 0;
+                return 0;
+            }
+        #endif // NRF_PACKET_SEQUENCE
+
+        // or are dropped, and with them the rest of a message
+        // that lost a fragment, returns the items lost.
+        // the dongle may or may not have the last item the next delta
+        // would build on, so the next packet is a keyframe
+        this->delta_left = 0;
+        if (this->fragment == 0) {
+            return items;
+        }
+        this->fragment = 0;
+        this->message++;
+        return items + 1;
+    }
+#endif // NRF_LINK_HOST
+
+// Report Lost
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::report_lost(uint8_t items) {
+        // items dropped without a packet of their own failing,
+        // the send callback hears of every item once
+        if (items > 0 && this->send_callback != nullptr) {
+            this->send_callback(false, items, this->send_context);
+        }
+    }
+#endif // NRF_LINK_HOST
+
+// Expected Sequence
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> uint8_t NRFDongle<Backend, TData, max_packets, TReply, max_replies>::expected_sequence() {
+        // the number of the oldest data packet still to be acknowledged,
+        // carried by pings and control packets so the dongle can tell
+        // which packets it missed
+        #ifdef NRF_PACKET_SEQUENCE
+            if (!this->window.isEmpty()) {
+                return this->window.first().sequence();
+            }
+        #endif // NRF_PACKET_SEQUENCE
+        return this->sequence;
+    }
+#endif // NRF_LINK_HOST
+
+// Set Reliable
+#ifdef NRF_PACKET_SEQUENCE
+    #ifdef NRF_LINK_HOST
+        template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::set_reliable(bool reliable) {
+            // turning it off drops the unacknowledged packets
+            this->reliable = reliable;
+            this->window.clear();
+            this->window_sent = 0;
+            this->delta_left = 0;
+        }
+    #endif // NRF_LINK_HOST
+#endif // NRF_PACKET_SEQUENCE
+
+// Send Buffered
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::send_buffered() {
+        // send one packet of buffered items with a blocking write
+        Packet<TData> packet;
+        uint8_t count = this->load_packet(packet);
+        bool report = this->write_frame(packet.bytes, packet.length());
+        if (report) {
+            this->confirm_packets(1);
+        } else {
+            count = this->resend_packets(count);
+        }
+        this->observe(report);
+        if (this->send_callback != nullptr) {
+            this->send_callback(report, count, this->send_context);
+        }
+
+        // if the packet was received, reset the ping timer
+        // and collect any reply that came back on the ACK
+        if (report) {
+            this->ping_timer = 0;
+            this->read_replies();
+        }
+
+        return report;
+    }
+#endif // NRF_LINK_HOST
+
+// Send Burst
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::send_burst() {
+        // drain the buffer for up to burst_budget_micros,
+        // keeping the radio's 3 level TX FIFO full with writeFast
+        // so the radio never waits on us between packets.
+        // the budget only limits queueing, so the burst can overrun it
+        // by the time the FIFO takes to empty (up to 3 packets).
+        // without a budget it sends the fragments of one item
+        uint32_t start = micros();
+        bool report = true;
+        uint8_t written = 0;
+        uint8_t confirmed = 0;
+        uint8_t items = 0;
+        // items of the packets in the FIFO, oldest first, and the items
+        // of the packets known to be through, and of those that failed
+        uint8_t queued[3];
+        uint8_t queued_count = 0;
+        uint8_t delivered = 0;
+        uint8_t failed = 0;
+
+        while (this->has_packet() && (this->burst_budget_micros > 0 ? (uint32_t)(micros() - start) < this->burst_budget_micros : items == 0)) {
+            Packet<TData> packet;
+            uint8_t count = this->load_packet(packet);
+            items += count;
+
+            // a packet hit the retry limit, stop queueing,
+            // this one never went out
+            if (!this->radio.writeFast(packet.bytes, packet.length())) {
+                failed += count;
+                report = false;
+                break;
+            }
+
+            written++;
+
+            // the FIFO holds 3 packets, so the one before them is through
+            if (queued_count == 3) {
+                this->confirm_packets(1);
+                confirmed++;
+                delivered += queued[0];
+                queued[0] = queued[1];
+                queued[1] = queued[2];
+                queued_count--;
+            }
+            queued[queued_count++] = count;
+
+            // make room in the RX FIFO for the replies on the next ACKs
+            this->read_replies();
+        }
+
+        // wait for the FIFO to empty, the link has only
+        // failed if a packet ran out of retries during the burst
+        if (!this->radio.txStandBy()) {
+            report = false;
+        }
+
+        // not knowing which of the packets still in the FIFO got through
+        // before one of them failed, they all count as failed, a reliable
+        // host sends them again and the dongle drops repeats
+        for (uint8_t i = 0; i < queued_count; i++) {
+            if (report) {
+                delivered += queued[i];
+            } else {
+                failed += queued[i];
+            }
+        }
+        if (report) {
+            this->confirm_packets(_RELIABLE_WINDOW_);
+            confirmed += queued_count;
+        } else {
+            failed = this->resend_packets(failed);
+        }
+
+        // replies of the last packets of the burst. one packet failed,
+        // the others still in the FIFO are unconfirmed, and only the
+        // retransmits of the last one sent are known
+        this->read_replies();
+        this->observe(report);
+        NRF_STATS_ADD(frames_sent, written);
+        NRF_STATS_ADD(frames_acked, confirmed);
+        NRF_STATS_ADD(frames_failed, written > confirmed && !report ? 1 : 0);
+        NRF_STATS_ADD(frames_unconfirmed, written > confirmed && !report ? written - confirmed - 1 : 0);
+        NRF_STATS_ADD(retransmits, this->radio.getARC());
+        NRF_STATS_ADD(retransmit_frames, written > 0 ? 1 : 0);
+        if (this->send_callback != nullptr) {
+            // the packets that got through, then the rest if one failed
+            if (report || delivered > 0) {
+                this->send_callback(true, delivered, this->send_context);
+            }
+            if (!report) {
+                this->send_callback(false, failed, this->send_context);
+            }
+        }
+
+        // if the packets were received, reset the ping timer
+        // and the wake window
+        if (report) {
+            this->ping_timer = 0;
+            this->wake_timer = 0;
+        }
+
+        return report;
+    }
+#endif // NRF_LINK_HOST
+
+// Set Burst Budget
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::set_burst_budget(uint16_t budget_micros) {
+        this->burst_budget_micros = budget_micros;
+    }
+#endif // NRF_LINK_HOST
+
+// Set Max Items Per Packet
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::set_max_items_per_packet(uint8_t max_items) {
+        this->max_items_per_packet = max_items;
+    }
+#endif // NRF_LINK_HOST
+
+// Set Adaptive
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::set_adaptive(bool adaptive) {
+        // turning it off leaves the link where it is
+        this->adaptive = adaptive;
+        this->adapt_packets = 0;
+        this->adapt_retries = 0;
+        this->adapt_lost = 0;
+        this->adapt_clean = 0;
+        if (adaptive && this->paired) {
+            this->apply_retries();
+        }
+    }
+#endif // NRF_LINK_HOST
+
+// Set Delta
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::set_delta(uint8_t keyframe_interval) {
+        this->delta_keyframes = keyframe_interval;
+        this->delta_left = 0;
+    }
+#endif // NRF_LINK_HOST
+
+// Set Max Ping Interval
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::set_max_ping_interval(uint16_t max_interval_millis) {
+        // a paired dongle keeps the interval it was told when pairing,
+        // so it only grows as far as that until the next pairing
+        this->max_ping_interval_millis = max_interval_millis;
+        this->keepalive_millis = this->ping_interval_millis;
+    }
+#endif // NRF_LINK_HOST
+
+// Set Wake Interval
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::set_wake_interval(uint16_t interval_millis) {
+        // used from the next pairing on, the dongle has to know it
+        this->wake_interval_millis = interval_millis;
+    }
+#endif // NRF_LINK_HOST
+
+// Wake Due
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::wake_due() {
+        // true while the dongle listens: right after our last
+        // acknowledged packet, and in a window every wake interval after it,
+        // packets only start early in a window (see _WAKE_START_MILLIS_)
+        if (this->link_wake_millis == 0) {
+            return true;
+        }
+
+        uint32_t since = this->wake_timer;
+        if (since < _WAKE_START_MILLIS_) {
+            return true;
+        }
+        return since >= this->link_wake_millis && since % this->link_wake_millis < _WAKE_START_MILLIS_;
+    }
+#endif // NRF_LINK_HOST
+
+// Set Migration Threshold
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::set_migration_threshold(uint8_t loss_percent) {
+        this->migrate_percent = loss_percent > 100 ? 100 : loss_percent;
+        this->migrate_wait = 0;
+    }
+#endif // NRF_LINK_HOST
+
+// Observe
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::observe(bool delivered) {
+        // pings back off while packets get through at the first try,
+        // come closer on a retransmit, and start over on a lost packet
+        if (this->max_ping_interval_millis > this->ping_interval_millis) {
+            uint16_t keepalive = this->keepalive_millis;
+            if (!delivered) {
+                keepalive = this->ping_interval_millis;
+            } else if (this->radio.getARC() > 0) {
+                keepalive /= 2;
+            } else if (keepalive < this->max_ping_interval_millis / 2) {
+                keepalive *= 2;
+            } else {
+                keepalive = this->max_ping_interval_millis;
+            }
+            this->keepalive_millis = keepalive < this->ping_interval_millis ? this->ping_interval_millis : keepalive;
+        }
+
+        if ((!this->adaptive && this->migrate_percent == 0) || !this->paired) {
+            return;
+        }
+
+        // retransmits of the last packet, all of them if it was lost
+        this->adapt_packets++;
+        this->adapt_retries += this->radio.getARC();
+        if (!delivered) {
+            this->adapt_lost++;
+        }
+
+        if (this->adapt_packets < _ADAPT_WINDOW_) {
+            return;
+        }
+
+        uint16_t retries = this->adapt_retries;
+        uint8_t lost = this->adapt_lost;
+        this->adapt_packets = 0;
+        this->adapt_retries = 0;
+        this->adapt_lost = 0;
+
+        // too many transmissions lost, look for a quieter channel first
+        if (this->migrate_wait > 0) {
+            this->migrate_wait--;
+        }
+        uint32_t attempts = (uint32_t)retries + _ADAPT_WINDOW_;
+        if (this->migrate_percent > 0 && this->migrate_wait == 0 && (uint32_t)retries * 100 > attempts * this->migrate_percent) {
+            this->migrate_wait = _MIGRATE_HOLDOFF_;
+            if (this->migrate() || !this->paired) {
+                return;
+            }
+        }
+
+        if (!this->adaptive) {
+            return;
+        }
+
+        // a lost packet, or more than 2 retransmits per packet, is too many,
+        // less than 1 per 4 packets leaves room for a faster data rate
+        if (lost > 0 || retries > 2 * _ADAPT_WINDOW_) {
+            this->step_down();
+        } else if (retries < _ADAPT_WINDOW_ / 4) {
+            this->adapt_clean++;
+            if (this->adapt_clean >= this->adapt_holdoff) {
+                this->step_up();
+            }
+        } else {
+            this->adapt_clean = 0;
+        }
+    }
+#endif // NRF_LINK_HOST
+
+// Step Down
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::step_down() {
+        // going back up has to wait longer every time it did not last
+        this->adapt_clean = 0;
+        if (this->adapt_holdoff < _ADAPT_HOLDOFF_MAX_) {
+            this->adapt_holdoff *= 2;
+        }
+
+        // more power first, it costs no airtime
+        if (this->link_power < _PA_MAX_) {
+            this->link_power++;
+            this->apply_power_level(this->link_power);
+            return;
+        }
+
+        // then a slower data rate, which is heard further
+        uint8_t rank = nrf_rate_rank(this->link_rate);
+        if (rank > Backend::rate_slowest) {
+            this->change_link(_CONTROL_DATA_RATE_, nrf_rate_at_rank(rank - 1));
+        }
+    }
+#endif // NRF_LINK_HOST
+
+// Step Up
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::step_up() {
+        this->adapt_clean = 0;
+        if (this->adapt_holdoff > _ADAPT_HOLDOFF_MIN_) {
+            this->adapt_holdoff /= 2;
+        }
+
+        // a faster data rate first, it is what cuts the latency
+        uint8_t rank = nrf_rate_rank(this->link_rate);
+        if (rank < 2) {
+            this->change_link(_CONTROL_DATA_RATE_, nrf_rate_at_rank(rank + 1));
+            return;
+        }
+
+        // then less power, down to the constructor's level
+        if (this->link_power > this->power_level) {
+            this->link_power--;
+            this->apply_power_level(this->link_power);
+        }
+    }
+#endif // NRF_LINK_HOST
+
+// Migrate
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::migrate() {
+        // returns true if the link moved to another channel
+        // the channel moved to is the one to propose when pairing again,
+        // and if there was none to move to, the band is scanned again then
+        uint8_t channel = this->quietest_channel(this->channel, _MIGRATE_CANDIDATES_, _MIGRATE_STEP_);
+        if (channel == this->channel) {
+            this->rescan();
+            return false;
+        }
+
+        uint8_t previous = this->channel;
+        if (this->change_link(_CONTROL_CHANNEL_, channel) && this->channel != previous) {
+            this->proposed_channel = this->channel;
+            return true;
+        }
+        this->rescan();
+        return false;
+    }
+#endif // NRF_LINK_HOST
+
+// Quietest Channel
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> uint8_t NRFDongle<Backend, TData, max_packets, TReply, max_replies>::quietest_channel(uint8_t first, uint8_t count, uint8_t step) {
+        // listen on count data channels, step apart from first, and return
+        // the one where the received power detector fired the least,
+        // the earliest of them on a tie
+        uint8_t current = this->radio.getChannel();
+        uint8_t best = first;
+        uint8_t best_busy = 0xFF;
+
+        for (uint8_t i = 0; i < count; i++) {
+            uint8_t channel = (first - 1 + (uint16_t)i * step) % _CHANNEL_COUNT_ + 1;
+            uint8_t busy = this->channel_busy(channel);
+            if (busy < best_busy) {
+                best = channel;
+                best_busy = busy;
+            }
+        }
+
+        this->radio.setChannel(current);
+        return best;
+    }
+#endif // NRF_LINK_HOST
+
+// Channel Busy
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> uint8_t NRFDongle<Backend, TData, max_packets, TReply, max_replies>::channel_busy(uint8_t channel) {
+        // how many of _SCAN_SAMPLES_ listens on channel the received
+        // power detector fired in, the radio is left on the channel
+        this->radio.setChannel(channel);
+
+        uint8_t busy = 0;
+        for (uint8_t sample = 0; sample < _SCAN_SAMPLES_; sample++) {
+            // the detector needs 170us of listening, 130us of it settling
+            this->radio.startListening();
+            delayMicroseconds(_RPD_LISTEN_MICROS_);
+            this->radio.stopListening();
+            if (this->radio.testRPD()) {
+                busy++;
+            }
+        }
+        return busy;
+    }
+#endif // NRF_LINK_HOST
+
+// Scan Step
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::scan_step() {
+        // listen on the next channel of the pairing scan, which goes over
+        // the whole band starting from our default channel, so it wins
+        // unless another one is quieter. sets proposed_channel once done
+        uint8_t current = this->radio.getChannel();
+        uint8_t first = this->unique_id % _CHANNEL_COUNT_ + 1;
+        uint8_t channel = (first - 1 + this->scan_index) % _CHANNEL_COUNT_ + 1;
+        uint8_t busy = this->channel_busy(channel);
+        this->radio.setChannel(current);
+
+        if (this->scan_index == 0 || busy < this->scan_best_busy) {
+            this->scan_best = channel;
+            this->scan_best_busy = busy;
+        }
+
+        this->scan_index++;
+        if (this->scan_index == _CHANNEL_COUNT_) {
+            this->proposed_channel = this->scan_best;
+            this->scan_index = 0;
+        }
+    }
+#endif // NRF_LINK_HOST
+
+// Rescan
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::rescan() {
+        this->proposed_channel = 0;
+        this->scan_index = 0;
+    }
+#endif // NRF_LINK_HOST
+
+// Change Link
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::change_link(uint8_t code, uint8_t value) {
+        // tell the dongle, which switches once it has handled the packet,
+        // then switch too and check it followed with a ping. if it did not,
+        // (the packet was lost, or the dongle has other hosts to keep)
+        // switch back and find it there. returns false if it was lost
+        uint8_t previous = code == _CONTROL_DATA_RATE_ ? this->link_rate : this->channel;
+
+        Packet<TData> packet;
+        packet.set_header(_PACKET_CONTROL_, code, this->expected_sequence());
+        packet.bytes[Packet<TData>::header_size] = value;
+        if (this->write_frame(packet.bytes, Packet<TData>::size(0) + 1)) {
+            this->read_replies();
+        }
+
+        if (this->apply_link(code, value) && this->ping_now()) {
+            this->ping_timer = 0;
+            return true;
+        }
+
+        this->apply_link(code, previous);
+        if (this->ping_now()) {
+            // refused, do not ask again for a long while
+            this->ping_timer = 0;
+            this->adapt_holdoff = _ADAPT_HOLDOFF_MAX_;
+            return true;
+        }
+
+        this->lose_dongle();
+        return false;
+    }
+#endif // NRF_LINK_HOST
+
+// Apply Link
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::apply_link(uint8_t code, uint8_t value) {
+        if (code == _CONTROL_DATA_RATE_) {
+            if (!this->apply_data_rate(value)) {
+                return false;
+            }
+            this->link_rate = value;
+            this->apply_retries();
+            return true;
+        }
+
+        this->channel = value;
+        this->radio.setChannel(this->channel);
+        return true;
+    }
+#endif // NRF_LINK_HOST
+
+// Recover
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::recover() {
+        // a packet was lost, before giving up on the dongle look for it
+        // at full power, then at the constructor's data rate,
+        // which it goes back to when another host pairs or it lost us.
+        // the non-blocking mode sends the same pings from update_async()
+        if (!this->recover_power()) {
+            return false;
+        }
+        if (this->ping_now()) {
+            this->ping_timer = 0;
+            return true;
+        }
+
+        if (this->recover_rate() && this->ping_now()) {
+            this->ping_timer = 0;
+            return true;
+        }
+
+        return false;
+    }
+#endif // NRF_LINK_HOST
+
+// Recover Power
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::recover_power() {
+        // the first step of recover(), start over at full power,
+        // returns false if the link does not adapt
+        if (!this->adaptive || !this->paired) {
+            return false;
+        }
+
+        this->adapt_packets = 0;
+        this->adapt_retries = 0;
+        this->adapt_lost = 0;
+        this->adapt_clean = 0;
+
+        this->link_power = _PA_MAX_;
+        this->apply_power_level(this->link_power);
+        return true;
+    }
+#endif // NRF_LINK_HOST
+
+// Recover Rate
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::recover_rate() {
+        // the second, back to the constructor's data rate,
+        // returns false if the link is already there
+        if (this->link_rate == this->data_rate) {
+            return false;
+        }
+
+        this->link_rate = this->data_rate;
+        this->apply_data_rate(this->link_rate);
+        this->apply_retries();
+        return true;
+    }
+#endif // NRF_LINK_HOST
+
+// Apply Retries
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::apply_retries() {
+        // the radio must hear the ACK, with the longest reply on it,
+        // within the retry delay: 130us to turn around plus its airtime
+        uint8_t ack_size = Packet<TReply>::size(Packet<TReply>::max_items);
+        uint16_t ack_micros = 130 + nrf_air_micros(ack_size, this->link_rate);
+        uint8_t delay = (ack_micros + 249) / 250 - 1;
+
+        // and as many retries as fit in the time the constructor's took
+        uint16_t budget = (uint16_t)this->retry_count * (this->retry_delay + 1);
+        uint16_t count = (budget + delay) / (delay + 1);
+        if (count > 15) {
+            count = 15;
+        }
+
+        this->radio.setRetries(delay, (uint8_t)count);
+    }
+#endif // NRF_LINK_HOST
+
+// Reset Link
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::reset_link() {
+        this->link_rate = this->data_rate;
+        this->link_power = this->power_level;
+        this->apply_data_rate(this->link_rate);
+        this->apply_power_level(this->link_power);
+        this->radio.setRetries(this->retry_delay, this->retry_count);
+        this->adapt_packets = 0;
+        this->adapt_retries = 0;
+        this->adapt_lost = 0;
+        this->adapt_clean = 0;
+        this->adapt_holdoff = _ADAPT_HOLDOFF_MIN_;
+    }
+#endif // NRF_LINK_HOST
+
+// Ping
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::ping() {
+        // returns true if ping was sent and acknowledged
+        // or if there is no need to ping
+        // returns false if the ping was sent but not acknowledged
+        // therefore signaling that the pair is broken
+
+        if (!this->enabled){
+            return true;
+        }
+
+        if (!this->paired){
+            return true;
+        }
+
+        // a packet in flight will do
+        if (this->frame_kind != _FRAME_NONE_) {
+            return true;
+        }
+
+        if (this->ping_timer > this->keepalive_millis) {
+            this->ping_timer = 0;
+
+            bool report = this->ping_now();
+            this->observe(report);
+            return report;
+        }
+
+        return true;
+    }
+#endif // NRF_LINK_HOST
+
+// Ping Now
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::ping_now() {
+        Packet<TData> ping_packet;
+        uint8_t size = this->build_ping(ping_packet);
+
+        #if defined(NRF_STATS) || defined(NRF_PACKET_TIMESTAMP)
+            uint32_t start = micros();
+        #endif // NRF_STATS || NRF_PACKET_TIMESTAMP
+        bool report = this->write_frame(ping_packet.bytes, size);
+        NRF_STATS_ADD(pings, 1);
+
+        // a ping can carry a reply back too
+        if (report) {
+            #if defined(NRF_STATS) || defined(NRF_PACKET_TIMESTAMP)
+                this->time_ping((uint32_t)(micros() - start));
+            #endif // NRF_STATS || NRF_PACKET_TIMESTAMP
+            this->read_replies();
+        }
+
+        return report;
+    }
+#endif // NRF_LINK_HOST
+
+// Write Frame
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::write_frame(uint8_t *bytes, uint8_t size) {
+        // blocking write of one packet, counted in the stats
+        bool report = this->radio.write(bytes, size);
+        if (report) {
+            this->wake_timer = 0;
+        }
+        NRF_STATS_ADD(frames_sent, 1);
+        NRF_STATS_ADD(frames_acked, report ? 1 : 0);
+        NRF_STATS_ADD(frames_failed, report ? 0 : 1);
+        NRF_STATS_ADD(retransmits, this->radio.getARC());
+        NRF_STATS_ADD(retransmit_frames, 1);
+        return report;
+    }
+#endif // NRF_LINK_HOST
+
+// Start Frame
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::start_frame(uint8_t *bytes, uint8_t size, uint8_t kind) {
+        // hand one packet to the radio, which sends and retries it
+        // on its own, poll_frame() tells when it is done
+        this->frame_kind = kind;
+        this->frame_start_micros = micros();
+
+        Backend::start_write(this->radio, bytes, size, this->frame_delivered);
+    }
+#endif // NRF_LINK_HOST
+
+// Start Ping
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::start_ping(uint8_t kind) {
+        Packet<TData> ping_packet;
+        uint8_t size = this->build_ping(ping_packet);
+        this->start_frame(ping_packet.bytes, size, kind);
+        NRF_STATS_ADD(pings, 1);
+    }
+#endif // NRF_LINK_HOST
+
+// Poll Frame
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::poll_frame(bool &delivered) {
+        // returns false while the packet is in flight,
+        // then true with whether it was acknowledged
+        delivered = this->frame_delivered;
+        if (!Backend::poll_write(this->radio, delivered)) {
+            return false;
+        }
+
+        if (delivered) {
+            this->wake_timer = 0;
+        }
+        NRF_STATS_ADD(frames_sent, 1);
+        NRF_STATS_ADD(frames_acked, delivered ? 1 : 0);
+        NRF_STATS_ADD(frames_failed, delivered ? 0 : 1);
+        NRF_STATS_ADD(retransmits, this->radio.getARC());
+        NRF_STATS_ADD(retransmit_frames, 1);
+        return true;
+    }
+#endif // NRF_LINK_HOST
+
+// Abort Frame
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::abort_frame() {
+        // forget the packet in flight, its items are lost,
+        // or sent again by a reliable host
+        if (this->frame_kind != _FRAME_NONE_) {
+            bool data = this->frame_kind == _FRAME_DATA_;
+            this->frame_kind = _FRAME_NONE_;
+            this->radio.flush_tx();
+            if (data) {
+                this->report_lost(this->resend_packets(this->frame_items));
+            }
+        }
+    }
+#endif // NRF_LINK_HOST
+
+// Update Async
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::update_async() {
+        // poll the packet in flight once, and only while packets are
+        // done with budget left, start the next one, returning as soon
+        // as one is in flight or there is nothing to send
+        uint32_t start = micros();
+        while (true) {
+            if (this->frame_kind != _FRAME_NONE_) {
+                bool delivered;
+                if (!this->poll_frame(delivered)) {
+                    return;
+                }
+                this->finish_frame(delivered);
+
+                // finishing a packet can start the next try of its own
+                if (this->frame_kind != _FRAME_NONE_ || (uint32_t)(micros() - start) >= this->update_budget_micros) {
+                    return;
+                }
+            }
+
+            if (!this->start_next()) {
+                return;
+            }
+        }
+    }
+#endif // NRF_LINK_HOST
+
+// Start Next
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::start_next() {
+        // start the next packet, returns false if there is none to send yet
+
+        // a pairing packet, as update() would have sent
+        if (!this->paired) {
+            if (this->pair_timeout_millis > 0 && this->pair_timer > this->pair_timeout_millis) {
+                this->end();
+                return false;
+            }
+
+            // the scan for a quiet channel, one channel per update()
+            if (this->proposed_channel == 0) {
+                this->scan_step();
+                return false;
+            }
+            if (!this->pair_due()) {
+                return false;
+            }
+
+            PairingPacket pairing_packet;
+            this->build_pairing_packet(pairing_packet);
+            this->frame_payload_size = pairing_packet.payload_size;
+
+            uint8_t buf[32];
+            pairing_packet.encode(buf);
+            this->start_frame(buf, PairingPacket::size, _FRAME_PAIR_);
+            return true;
+        }
+
+        // a ping to the lost dongle, with the backoff of reconnect()
+        if (this->reconnecting) {
+            if (!this->reconnect_due()) {
+                return false;
+            }
+
+            // the adaptive link looks for it as recover() does
+            if (this->recover_power()) {
+                this->start_ping(_FRAME_RECOVER_);
+                return true;
+            }
+
+            this->start_ping(_FRAME_PROBE_);
+            return true;
+        }
+
+        // the rest waits for the dongle to listen
+        if (!this->wake_due()) {
+            return false;
+        }
+
+        // queued items, as many as fit in one packet
+        if (this->has_packet()) {
+            Packet<TData> packet;
+            this->frame_items = this->load_packet(packet);
+            this->start_frame(packet.bytes, packet.length(), _FRAME_DATA_);
+            return true;
+        }
+
+        // or a ping when it is due
+        if (this->ping_timer > this->keepalive_millis) {
+            this->ping_timer = 0;
+            this->start_ping(_FRAME_PING_);
+            return true;
+        }
+
+        return false;
+    }
+#endif // NRF_LINK_HOST
+
+// Finish Frame
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::finish_frame(bool delivered) {
+        // what update() does after each blocking write
+        uint8_t kind = this->frame_kind;
+        this->frame_kind = _FRAME_NONE_;
+
+        if (kind == _FRAME_PAIR_) {
+            if (!delivered || !this->accept_pairing(this->frame_payload_size)) {
+                this->pair_tried(delivered);
+            }
+            return;
+        }
+
+        if (kind == _FRAME_PROBE_) {
+            if (delivered) {
+                this->read_replies();
+            }
+            this->reconnect_tried(delivered);
+            return;
+        }
+
+        // a step of recover(), lost at full power, try once more
+        // at the constructor's data rate, then give up on the dongle,
+        // or when looking for it already, try again later
+        if (kind == _FRAME_RECOVER_) {
+            if (!delivered && this->recover_rate()) {
+                this->start_ping(_FRAME_RECOVER_);
+                return;
+            }
+            if (delivered) {
+                this->ping_timer = 0;
+                this->read_replies();
+            }
+            if (this->reconnecting) {
+                this->reconnect_tried(delivered);
+            } else if (!delivered) {
+                this->lose_dongle();
+            }
+            return;
+        }
+
+        if (kind == _FRAME_DATA_) {
+            if (delivered) {
+                this->confirm_packets(1);
+            } else {
+                this->frame_items = this->resend_packets(this->frame_items);
+            }
+        }
+
+        this->observe(delivered);
+        if (kind == _FRAME_DATA_ && this->send_callback != nullptr) {
+            this->send_callback(delivered, this->frame_items, this->send_context);
+        }
+
+        // the link may have been lost or changed while observing
+        if (!this->paired || this->reconnecting) {
+            return;
+        }
+
+        if (delivered) {
+            #if defined(NRF_STATS) || defined(NRF_PACKET_TIMESTAMP)
+                if (kind == _FRAME_PING_) {
+                    this->time_ping((uint32_t)(micros() - this->frame_start_micros));
+                }
+            #endif // NRF_STATS || NRF_PACKET_TIMESTAMP
+            this->ping_timer = 0;
+            this->read_replies();
+        } else if (this->recover_power()) {
+            // look for the dongle a ping at a time, as recover() would
+            this->start_ping(_FRAME_RECOVER_);
+        } else {
+            this->lose_dongle();
+        }
+    }
+#endif // NRF_LINK_HOST
+
+// Set Send Callback
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::set_send_callback(SendCallback callback, void *context) {
+        this->send_callback = callback;
+        this->send_context = context;
+    }
+#endif // NRF_LINK_HOST
+
+// Set Update Budget
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::set_update_budget(uint16_t budget_micros) {
+        this->update_budget_micros = budget_micros;
+    }
+#endif // NRF_LINK_HOST
+
+// Is Sending
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::is_sending() {
+        return this->frame_kind != _FRAME_NONE_;
+    }
+#endif // NRF_LINK_HOST
+
+// Read Replies
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::read_replies() {
+        // ACK payloads land in the RX FIFO, move them to the reply buffer
+        while (this->radio.available()) {
+            Packet<TReply> packet;
+            // a size of 0 means the payload was corrupt
+            uint8_t size = this->radio.getDynamicPayloadSize();
+            this->radio.read(packet.bytes, size);
+            NRF_STATS_ADD(frames_received, 1);
+
+            if (size > 0 && packet.type() == _PACKET_DATA_ && packet.fits(size)) {
+                for (uint8_t i = 0; i < packet.count(); i++) {
+                    TReply data;
+                    packet.get(i, data);
+                    this->reply_buffer.push(data);
+                }
+            }
+        }
+    }
+#endif // NRF_LINK_HOST
+
+// Read (Reply)
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::read(TReply &data, bool pop) {
+        if (!this->enabled){
+            return false;
+        }
+
+        if (this->reply_buffer.isEmpty()){
+            return false;
+        }
+
+        if (pop) {
+            data = this->reply_buffer.shift();
+        } else {
+            data = this->reply_buffer.first();
+        }
+
+        return true;
+    }
+#endif // NRF_LINK_HOST
+
+// Has Reply
+#ifdef NRF_LINK_HOST
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::has_reply() {
+        return !this->reply_buffer.isEmpty();
+    }
+#endif // NRF_LINK_HOST
+
+// Send (Reply)
+#ifdef NRF_LINK_DONGLE
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::send(TReply data, uint8_t host) {
+        if (!this->enabled){
+            return false;
+        }
+
+        if (host >= NRF_MAX_HOSTS || this->hosts[host].state != _HOST_PAIRED_){
+            return false;
+        }
+
+        this->hosts[host].reply_buffer.push(data);
+        return true;
+    }
+#endif // NRF_LINK_DONGLE
+
+// Loaded Replies
+#ifdef NRF_LINK_DONGLE
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> uint8_t NRFDongle<Backend, TData, max_packets, TReply, max_replies>::loaded_replies() {
+        uint8_t loaded = 0;
+        for (uint8_t i = 0; i < NRF_MAX_HOSTS; i++) {
+            loaded += this->hosts[i].loaded_replies;
+        }
+        return loaded;
+    }
+#endif // NRF_LINK_DONGLE
+
+// Load Replies
+#ifdef NRF_LINK_DONGLE
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::load_replies() {
+        // the radio sends one loaded payload with each ACK to the host
+        // on its pipe. keep up to 2 reply packets loaded between all hosts
+        // (the TX FIFO has 3 levels, one is left for a pairing accept),
+        // and only load while no packet is waiting to be read,
+        // so every packet we read has taken one loaded reply with its ACK
+        for (uint8_t i = 0; i < NRF_MAX_HOSTS; i++) {
+            Host &host = this->hosts[i];
+            if (host.state != _HOST_PAIRED_) {
+                continue;
+            }
+
+            while (this->loaded_replies() < 2 && !host.reply_buffer.isEmpty() && !this->frame_waiting()) {
+                Packet<TReply> packet;
+                uint8_t count = 0;
+                while (count < Packet<TReply>::max_items && !host.reply_buffer.isEmpty() && packet.room_for(count, host.reply_buffer.first(), 32)) {
+                    packet.set(count, host.reply_buffer.shift());
+                    count++;
+                }
+                packet.set_header(_PACKET_DATA_, count);
+
+                // a packet of NRFMessages is as long as their type makes it
+                uint8_t size = Packet<TReply>::typed ? packet.length() : Packet<TReply>::size(count);
+                this->radio.writeAckPayload(i + 1, packet.bytes, size);
+                host.loaded_replies++;
+                NRF_STATS_ADD(frames_sent, 1);
+            }
+        }
+    }
+#endif // NRF_LINK_DONGLE
+
+// Read
+#ifdef NRF_LINK_DONGLE
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::read(TData &data, bool pop) {
+        uint8_t host;
+        return this->read(data, host, pop);
+    }
+#endif // NRF_LINK_DONGLE
+
+// Read (Host)
+#ifdef NRF_LINK_DONGLE
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::read(TData &data, uint8_t &host, bool pop) {
+        if (!this->enabled){
+            return false;
+        }
+
+        // packets the interrupt moved out of the radio since update()
+        #ifdef NRF_LINK_IRQ
+            while (this->receive());
+        #endif // NRF_LINK_IRQ
+
+        if (!this->paired){
+            return false;
+        }
+
+        // take turns between the hosts that have data,
+        // so a busy host can not starve the others
+        for (uint8_t n = 0; n < NRF_MAX_HOSTS; n++) {
+            uint8_t i = (this->read_host + n) % NRF_MAX_HOSTS;
+            if (this->hosts[i].state != _HOST_PAIRED_ || this->hosts[i].buffer.isEmpty()) {
+                continue;
+            }
+
+            if (pop) {
+                data = this->hosts[i].buffer.shift();
+                this->read_host = (i + 1) % NRF_MAX_HOSTS;
+            } else {
+                data = this->hosts[i].buffer.first();
+            }
+            #ifdef NRF_PACKET_TIMESTAMP
+                this->read_sent = pop ? this->hosts[i].sent.shift() : this->hosts[i].sent.first();
+            #endif // NRF_PACKET_TIMESTAMP
+
+            host = i;
+            return true;
+        }
+
+        return false;
+    }
+#endif // NRF_LINK_DONGLE
+
+// Read (Age)
+#ifdef NRF_PACKET_TIMESTAMP
+    #ifdef NRF_LINK_DONGLE
+        template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::read(TData &data, uint8_t &host, uint32_t &age_micros, bool pop) {
+            if (!this->read(data, host, pop)) {
+                return false;
+            }
+            age_micros = micros() - this->read_sent;
+            return true;
+        }
+    #endif // NRF_LINK_DONGLE
+#endif // NRF_PACKET_TIMESTAMP
+
+// Read Batch
+#ifdef NRF_LINK_DONGLE
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> size_t NRFDongle<Backend, TData, max_packets, TReply, max_replies>::read_batch(TData *data, size_t n, uint8_t host) {
+        if (!this->enabled){
+            return 0;
+        }
+
+        // packets the interrupt moved out of the radio since update()
+        #ifdef NRF_LINK_IRQ
+            while (this->receive());
+        #endif // NRF_LINK_IRQ
+
+        if (!this->is_host_paired(host)){
+            return 0;
+        }
+
+        size_t count = this->hosts[host].buffer.read(data, n);
+        #ifdef NRF_PACKET_TIMESTAMP
+            this->hosts[host].sent.consume(count);
+        #endif // NRF_PACKET_TIMESTAMP
+        return count;
+    }
+#endif // NRF_LINK_DONGLE
+
+// Peek
+#ifdef NRF_LINK_DONGLE
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> size_t NRFDongle<Backend, TData, max_packets, TReply, max_replies>::peek(const TData *&data, uint8_t host) {
+        if (!this->enabled){
+            return 0;
+        }
+
+        // packets the interrupt moved out of the radio since update()
+        #ifdef NRF_LINK_IRQ
+            while (this->receive());
+        #endif // NRF_LINK_IRQ
+
+        if (!this->is_host_paired(host)){
+            return 0;
+        }
+
+        return this->hosts[host].buffer.peek(data);
+    }
+#endif // NRF_LINK_DONGLE
+
+// Consume
+#ifdef NRF_LINK_DONGLE
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::consume(size_t n, uint8_t host) {
+        if (!this->is_host_paired(host)){
+            return;
+        }
+
+        this->hosts[host].buffer.consume(n);
+        #ifdef NRF_PACKET_TIMESTAMP
+            this->hosts[host].sent.consume(n);
+        #endif // NRF_PACKET_TIMESTAMP
+    }
+#endif // NRF_LINK_DONGLE
+
+// Get High Water Mark (Host)
+#ifdef NRF_LINK_DONGLE
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> uint8_t NRFDongle<Backend, TData, max_packets, TReply, max_replies>::get_high_water_mark(uint8_t host) {
+        if (host >= NRF_MAX_HOSTS) {
+            return 0;
+        }
+
+        return this->hosts[host].buffer.high_water_mark();
+    }
+#endif // NRF_LINK_DONGLE
+
+// Reset High Water Mark (Host)
+#ifdef NRF_LINK_DONGLE
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::reset_high_water_mark(uint8_t host) {
+        if (host >= NRF_MAX_HOSTS) {
+            return;
+        }
+
+        this->hosts[host].buffer.reset_high_water_mark();
+    }
+#endif // NRF_LINK_DONGLE
+
+// Is Host Paired
+#ifdef NRF_LINK_DONGLE
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::is_host_paired(uint8_t host) {
+        return host < NRF_MAX_HOSTS && this->hosts[host].state == _HOST_PAIRED_;
+    }
+#endif // NRF_LINK_DONGLE
+
+// Get Host Unique ID
+#ifdef NRF_LINK_DONGLE
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> uint64_t NRFDongle<Backend, TData, max_packets, TReply, max_replies>::get_host_unique_id(uint8_t host) {
+        if (!this->is_host_paired(host)) {
+            return 0;
+        }
+        return this->hosts[host].unique_id;
+    }
+#endif // NRF_LINK_DONGLE
+
+// Get Host Count
+#ifdef NRF_LINK_DONGLE
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> uint8_t NRFDongle<Backend, TData, max_packets, TReply, max_replies>::get_host_count() {
+        uint8_t count = 0;
+        for (uint8_t i = 0; i < NRF_MAX_HOSTS; i++) {
+            if (this->hosts[i].state == _HOST_PAIRED_) {
+                count++;
+            }
+        }
+        return count;
+    }
+#endif // NRF_LINK_DONGLE
+
+// Has Hosts
+#ifdef NRF_LINK_DONGLE
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::has_hosts() {
+        // true if any host is paired or pairing
+        for (uint8_t i = 0; i < NRF_MAX_HOSTS; i++) {
+            if (this->hosts[i].state != _HOST_FREE_) {
+                return true;
+            }
+        }
+        return false;
+    }
+#endif // NRF_LINK_DONGLE
+
+// Has Room
+#ifdef NRF_LINK_DONGLE
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::has_room() {
+        // true if another host could pair, or a host is still pairing
+        for (uint8_t i = 0; i < NRF_MAX_HOSTS; i++) {
+            if (this->hosts[i].state != _HOST_PAIRED_) {
+                return true;
+            }
+        }
+        return false;
+    }
+#endif // NRF_LINK_DONGLE
+
+// Pipe Address
+#ifdef NRF_LINK_DONGLE
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> uint64_t NRFDongle<Backend, TData, max_packets, TReply, max_replies>::pipe_address(uint8_t pipe) {
+        // pipes 2-5 share the upper 4 bytes of pipe 1's address in the radio,
+        // so every host address is the dongle's address with its own low byte
+        return (this->address & 0xFFFFFFFF00ULL) | (uint8_t)(0xC0 + pipe);
+    }
+#endif // NRF_LINK_DONGLE
+
+// Receive
+#ifdef NRF_LINK_DONGLE
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::receive() {
+        // returns true if a packet was handled, even if it was dropped
+        #ifdef NRF_LINK_IRQ
+            // the interrupt already moved the packet out of the radio
+            const Frame *frame;
+            if (this->frames.peek(frame) == 0) {
+                // or left it there while the ring was full
+                noInterrupts();
+                this->irq();
+                interrupts();
+                if (this->frames.peek(frame) == 0) {
+                    return false;
+                }
+            }
+            this->handle_frame(*frame);
+            this->frames.consume(1);
+        #else
+            Frame frame;
+            if (!this->read_frame(frame)) {
+                return false;
+            }
+            this->handle_frame(frame);
+        #endif // NRF_LINK_IRQ
+        return true;
+    }
+#endif // NRF_LINK_DONGLE
+
+// Read Frame
+#ifdef NRF_LINK_DONGLE
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::read_frame(Frame &frame) {
+        if (!this->radio.available(&frame.pipe)) {
+            return false;
+        }
+
+        frame.size = this->radio.getDynamicPayloadSize();
+        this->radio.read(frame.packet.bytes, frame.size);
+        #ifdef NRF_PACKET_TIMESTAMP
+            frame.micros_received = micros();
+        #endif // NRF_PACKET_TIMESTAMP
+        return true;
+    }
+#endif // NRF_LINK_DONGLE
+
+// Frame Waiting
+#ifdef NRF_LINK_DONGLE
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::frame_waiting() {
+        // true if a packet was received but not handled yet
+        #ifdef NRF_LINK_IRQ
+            if (!this->frames.isEmpty()) {
+                return true;
+            }
+        #endif // NRF_LINK_IRQ
+        return this->radio.available();
+    }
+#endif // NRF_LINK_DONGLE
+
+// IRQ
+#ifdef NRF_LINK_IRQ
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::irq() {
+        // empty the radio's RX FIFO into the ring, which releases the IRQ pin.
+        // packets that find the ring full stay in the radio, which stops
+        // acknowledging once its FIFO fills up, so the host retries them
+        // instead of them being lost, receive() picks them up later
+        while (!this->frames.isFull() && this->read_frame(this->frames.reserve())) {
+            this->frames.commit();
+        }
+    }
+#endif // NRF_LINK_IRQ
+
+// Handle Frame
+#ifdef NRF_LINK_DONGLE
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::handle_frame(const Frame &frame) {
+        const Packet<TData> &packet = frame.packet;
+        uint8_t pipe = frame.pipe;
+        uint8_t size = frame.size;
+        NRF_STATS_ADD(frames_received, 1);
+        if (size == 0) {
+            return;
+        }
+
+        // pairing packets arrive on pipe 0
+        if (pipe == 0) {
+            // the ACK of this packet took the loaded accept with it
+            uint8_t accepted = this->loaded_accept;
+            this->loaded_accept = NRF_MAX_HOSTS;
+
+            // anything but a pairing packet is dropped
+            uint8_t host = NRF_MAX_HOSTS;
+            if (size == PairingPacket::size) {
+                PairingPacket pairing_packet;
+                pairing_packet.decode(packet.bytes);
+                host = this->accept_host(pairing_packet);
+            }
+
+            if (host < NRF_MAX_HOSTS && host == accepted) {
+                // the host has its accept and is moving to the data channel,
+                // follow it there, other hosts can pair in the next window
+                this->end_pair_window();
+                this->load_accept(host + 1, host);
+            } else if (host < NRF_MAX_HOSTS) {
+                // the host is still here and tries again at once, so its
+                // accept goes next, rather than one for a host that left
+                // (e.g. for another dongle) and holds its slot until it expires
+                this->load_accept(host, NRF_MAX_HOSTS);
+            } else {
+                this->load_accept(accepted + 1, NRF_MAX_HOSTS);
+            }
+            return;
+        }
+
+        if (pipe > NRF_MAX_HOSTS || this->hosts[pipe - 1].state == _HOST_FREE_) {
+            return;
+        }
+        Host &host = this->hosts[pipe - 1];
+
+        // the first packet on its pipe means the host got its accept
+        if (host.state == _HOST_PENDING_) {
+            host.state = _HOST_PAIRED_;
+            this->paired = true;
+            this->pair_timer = 0;
+            NRF_STATS_ADD(pairs, 1);
+        }
+
+        if (packet.type() == _PACKET_PING_) {
+            NRF_STATS_ADD(pings, 1);
+        }
+
+        #ifdef NRF_PACKET_TIMESTAMP
+            this->sync_clock(host, frame);
+        #endif // NRF_PACKET_TIMESTAMP
+
+        // a ping or control packet tells where the host's numbers are
+        if (packet.type() == _PACKET_PING_ || packet.type() == _PACKET_CONTROL_) {
+            this->follow_sequence(host, packet);
+        }
+
+        // a host asking for another data rate or channel, only followed
+        // while it is our only host, the others would lose us.
+        // the radio has sent the ACK already, the host pings to find out
+        if (packet.type() == _PACKET_CONTROL_ && size > packet.received_header_size()) {
+            uint8_t value = packet.bytes[packet.received_header_size()];
+            bool alone = !this->pair_window;
+            for (uint8_t i = 0; i < NRF_MAX_HOSTS; i++) {
+                if (i != pipe - 1 && this->hosts[i].state != _HOST_FREE_) {
+                    alone = false;
+                }
+            }
+            if (alone && packet.count() == _CONTROL_DATA_RATE_ && value <= _RATE_250KBPS_ && this->apply_data_rate(value)) {
+                this->link_rate = value;
+            }
+            if (alone && packet.count() == _CONTROL_CHANNEL_ && value >= 1 && value <= _CHANNEL_COUNT_) {
+                this->channel = value;
+                this->radio.setChannel(this->channel);
+            }
+        }
+
+        // push the items in the order they were sent,
+        // straight from the packet into the ring,
+        // a ping packet has no items, and a repeat is dropped
+        if (packet.type() == _PACKET_DATA_ && packet.fits(size) && this->follow_sequence(host, packet)) {
+            for (uint8_t i = 0; i < packet.count(); i++) {
+                packet.get(i, host.buffer.reserve());
+                this->commit_item(host);
+            }
+
+            // a delta packet builds on the last item we got
+            if (packet.is_delta()) {
+                this->apply_delta(host, packet, size);
+            } else if (packet.count() > 0) {
+                packet.get(packet.count() - 1, host.reference);
+                host.referenced = true;
+            }
+
+            #ifdef NRF_PACKET_TIMESTAMP
+                this->time_packet(host);
+            #endif // NRF_PACKET_TIMESTAMP
+        }
+
+        if (packet.type() == _PACKET_FRAGMENT_ && this->follow_sequence(host, packet)) {
+            this->assemble(host, packet, size);
+        }
+
+        // the ACK of this packet carried the oldest reply loaded for this host
+        if (host.loaded_replies > 0) {
+            host.loaded_replies--;
+        }
+
+        // if we have successfully received a packet
+        // reset the host's ping timer
+        host.ping_timer = 0;
+    }
+#endif // NRF_LINK_DONGLE
+
+// Follow Sequence
+#ifdef NRF_LINK_DONGLE
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> bool NRFDongle<Backend, TData, max_packets, TReply, max_replies>::follow_sequence(Host &host, const Packet<TData> &packet) {
+        // returns false if a data packet is a repeat of one we have,
+        // fragments are numbered like data packets
+        if (!packet.has_sequence()) {
+            return true;
+        }
+        uint8_t sequence = packet.sequence();
+        bool data = packet.type() == _PACKET_DATA_ || packet.type() == _PACKET_FRAGMENT_;
+
+        if (!host.sequenced) {
+            host.sequenced = true;
+            host.last_sequence = data ? sequence : sequence - 1;
+            return true;
+        }
+
+        if (data) {
+            // the host sent it again as its ACK was lost,
+            // a reliable host only goes back _RELIABLE_WINDOW_ packets
+            if ((uint8_t)(host.last_sequence - sequence) < _RELIABLE_WINDOW_) {
+                NRF_STATS_ADD(duplicates, 1);
+                return false;
+            }
+        } else {
+            // the host still has packets from sequence on to send,
+            // we may have up to _RELIABLE_WINDOW_ of them already
+            if ((uint8_t)(host.last_sequence + 1 - sequence) <= _RELIABLE_WINDOW_) {
+                return true;
+            }
+        }
+
+        // the packets in between were lost, unless the host
+        // went back further (it restarted), then just follow it
+        uint8_t missed = sequence - host.last_sequence - 1;
+        if (missed > 0) {
+            // a delta may build on an item that was lost
+            host.referenced = false;
+        }
+        if (missed < 128) {
+            host.missed_packets += missed;
+            NRF_STATS_ADD(gaps, missed);
+        }
+        host.last_sequence = data ? sequence : sequence - 1;
+        return true;
+    }
+#endif // NRF_LINK_DONGLE
+
+// Assemble
+#ifdef NRF_LINK_DONGLE
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::assemble(Host &host, const Packet<TData> &packet, uint8_t size) {
+        // fragments are written straight into the buffer's free slot,
+        // which the reader never sees, and the item is committed with
+        // the last one. they must arrive in order, a repeat of the one
+        // we just got (its ACK was lost) is dropped
+        uint8_t message = packet.count();
+        uint8_t index = packet.fragment_index();
+        if (host.assembling && message == host.message && index + 1 == host.fragment) {
+            return;
+        }
+
+        bool next = host.assembling && message == host.message && index == host.fragment;
+        if (!next) {
+            // the host moved on from the item we were putting together
+            if (host.assembling) {
+                host.assembling = false;
+                host.incomplete_items++;
+                NRF_STATS_ADD(incomplete, 1);
+            }
+
+            // we wait for the first fragment of the next one
+            if (index != 0) {
+                return;
+            }
+        }
+
+        if (!packet.get_fragment(host.buffer.reserve(), size)) {
+            host.assembling = false;
+            return;
+        }
+
+        if (packet.last_fragment()) {
+            host.assembling = false;
+            this->commit_item(host);
+            #ifdef NRF_PACKET_TIMESTAMP
+                this->time_packet(host);
+            #endif // NRF_PACKET_TIMESTAMP
+            return;
+        }
+
+        host.assembling = true;
+        host.message = message;
+        host.fragment = index + 1;
+    }
+#endif // NRF_LINK_DONGLE
+
+// Apply Delta
+#ifdef NRF_LINK_DONGLE
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::apply_delta(Host &host, const Packet<TData> &packet, uint8_t size) {
+        // rebuild the items in order, straight into the ring,
+        // each from the one before it and the first from the last item
+        // we got, without which the packet is dropped until a keyframe
+        uint8_t header = packet.received_header_size();
+        if (!host.referenced || size <= header) {
+            NRF_STATS_ADD(unreferenced, 1);
+            return;
+        }
+
+        uint8_t count = packet.bytes[header];
+        uint8_t offset = header + 1;
+        for (uint8_t i = 0; i < count; i++) {
+            TData &item = host.buffer.reserve();
+            item = host.reference;
+            offset = packet.get_delta(offset, size, item);
+            if (offset == 0) {
+                host.referenced = false;
+                return;
+            }
+            host.reference = item;
+            this->commit_item(host);
+            NRF_STATS_ADD(deltas, 1);
+        }
+    }
+#endif // NRF_LINK_DONGLE
+
+// Commit Item
+#ifdef NRF_LINK_DONGLE
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::commit_item(Host &host) {
+        // the item written into the buffer's free slot can be read now,
+        // with when it was sent next to it
+        if (!host.buffer.commit()) {
+            NRF_STATS_ADD(overflows, 1);
+        }
+        #ifdef NRF_PACKET_TIMESTAMP
+            host.sent.push(host.item_sent);
+        #endif // NRF_PACKET_TIMESTAMP
+    }
+#endif // NRF_LINK_DONGLE
+
+// Sync Clock
+#ifdef NRF_PACKET_TIMESTAMP
+    #ifdef NRF_LINK_DONGLE
+        template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::sync_clock(Host &host, const Frame &frame) {
+            // a packet arrives after it was stamped, so the difference
+            // between the clocks is at most the one it shows,
+            // the packets that took the shortest time show it best
+            const Packet<TData> &packet = frame.packet;
+            uint8_t header = packet.received_header_size();
+            if (frame.size < header) {
+                return;
+            }
+
+            // a ping also says how long a packet takes
+            if (packet.type() == _PACKET_PING_ && frame.size >= header + 2) {
+                host.ping_delay_micros = (uint32_t)nrf_read_le(&packet.bytes[header], 2);
+            }
+
+            uint32_t offset = frame.micros_received - packet.timestamp();
+            if (!host.clocked) {
+                host.clocked = true;
+                host.window_offset = offset;
+                host.previous_offset = offset;
+                host.clock_timer = 0;
+            } else if (host.clock_timer > _CLOCK_WINDOW_MILLIS_) {
+                host.previous_offset = host.window_offset;
+                host.window_offset = offset;
+                host.clock_timer = 0;
+            } else if ((int32_t)(offset - host.window_offset) < 0) {
+                host.window_offset = offset;
+            }
+
+            // the items it carries were sent at its stamp, by our clock
+            host.item_sent = packet.timestamp() + this->clock_offset(host);
+            int32_t latency = (int32_t)(frame.micros_received - host.item_sent);
+            host.item_latency = latency > 0 ? latency : 0;
+        }
+    #endif // NRF_LINK_DONGLE
+#endif // NRF_PACKET_TIMESTAMP
+
+// Clock Offset
+#ifdef NRF_PACKET_TIMESTAMP
+    #ifdef NRF_LINK_DONGLE
+        template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> uint32_t NRFDongle<Backend, TData, max_packets, TReply, max_replies>::clock_offset(const Host &host) {
+            uint32_t offset = host.window_offset;
+            if ((int32_t)(host.previous_offset - offset) < 0) {
+                offset = host.previous_offset;
+            }
+            return offset - host.ping_delay_micros;
+        }
+    #endif // NRF_LINK_DONGLE
+#endif // NRF_PACKET_TIMESTAMP
+
+// Time Packet
+#ifdef NRF_PACKET_TIMESTAMP
+    #ifdef NRF_LINK_DONGLE
+        template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::time_packet(Host &host) {
+            // count the latency of a data packet (or an item put together
+            // from fragments), and how far it moved from the one before
+            this->latency.latency[NRFLatency::bucket(host.item_latency)]++;
+            if (host.timed) {
+                uint32_t jitter = host.item_latency > host.last_latency ? host.item_latency - host.last_latency : host.last_latency - host.item_latency;
+                this->latency.jitter[NRFLatency::bucket(jitter)]++;
+            }
+            host.timed = true;
+            host.last_latency = host.item_latency;
+        }
+    #endif // NRF_LINK_DONGLE
+#endif // NRF_PACKET_TIMESTAMP
+
+// Get Latency
+#ifdef NRF_PACKET_TIMESTAMP
+    #ifdef NRF_LINK_DONGLE
+        template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> NRFLatency NRFDongle<Backend, TData, max_packets, TReply, max_replies>::get_latency() {
+            return this->latency;
+        }
+    #endif // NRF_LINK_DONGLE
+#endif // NRF_PACKET_TIMESTAMP
+
+// Reset Latency
+#ifdef NRF_PACKET_TIMESTAMP
+    #ifdef NRF_LINK_DONGLE
+        template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::reset_latency() {
+            memset(&this->latency, 0, sizeof(this->latency));
+        }
+    #endif // NRF_LINK_DONGLE
+#endif // NRF_PACKET_TIMESTAMP
+
+// Get Clock Offset
+#ifdef NRF_PACKET_TIMESTAMP
+    #ifdef NRF_LINK_DONGLE
+        template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> uint32_t NRFDongle<Backend, TData, max_packets, TReply, max_replies>::get_clock_offset(uint8_t host) {
+            if (host >= NRF_MAX_HOSTS) {
+                return 0;
+            }
+            return this->clock_offset(this->hosts[host]);
+        }
+    #endif // NRF_LINK_DONGLE
+#endif // NRF_PACKET_TIMESTAMP
+
+// Get Missed Packets
+#ifdef NRF_LINK_DONGLE
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> uint32_t NRFDongle<Backend, TData, max_packets, TReply, max_replies>::get_missed_packets(uint8_t host) {
+        if (host >= NRF_MAX_HOSTS) {
+            return 0;
+        }
+        return this->hosts[host].missed_packets;
+    }
+#endif // NRF_LINK_DONGLE
+
+// Get Incomplete Items
+#ifdef NRF_LINK_DONGLE
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> uint32_t NRFDongle<Backend, TData, max_packets, TReply, max_replies>::get_incomplete_items(uint8_t host) {
+        if (host >= NRF_MAX_HOSTS) {
+            return 0;
+        }
+        return this->hosts[host].incomplete_items;
+    }
+#endif // NRF_LINK_DONGLE
+
+// Set Duty Cycle
+#ifdef NRF_LINK_DONGLE
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::set_duty_cycle(bool duty_cycle) {
+        this->duty_cycle = duty_cycle;
+        if (!duty_cycle) {
+            this->wake();
+        }
+    }
+#endif // NRF_LINK_DONGLE
+
+// Get Sleep Millis
+#ifdef NRF_LINK_DONGLE
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> uint32_t NRFDongle<Backend, TData, max_packets, TReply, max_replies>::get_sleep_millis() {
+        // a host with no wake interval, a free slot a host could pair on,
+        // or a pairing window all need us listening
+        if (!this->enabled || !this->duty_cycle || this->pair_window) {
+            return 0;
+        }
+
+        uint32_t sleep = 0xFFFFFFFF;
+        for (uint8_t i = 0; i < NRF_MAX_HOSTS; i++) {
+            Host &host = this->hosts[i];
+            uint32_t interval = host.wake_interval_millis;
+            if (host.state != _HOST_PAIRED_ || interval <= _WAKE_GUARD_MILLIS_ + _WAKE_WINDOW_MILLIS_) {
+                return 0;
+            }
+
+            // the host's windows start at the last packet we heard,
+            // one that was not acknowledged moved ours but not its,
+            // so keep listening once it has been quiet for too long
+            uint32_t since = host.ping_timer;
+            if (since > (uint32_t)host.ping_interval_millis + interval + _WAKE_WINDOW_MILLIS_) {
+                return 0;
+            }
+
+            uint32_t phase = since % interval;
+            if (since < _WAKE_WINDOW_MILLIS_ || (since >= interval && phase < _WAKE_WINDOW_MILLIS_) || phase >= interval - _WAKE_GUARD_MILLIS_) {
+                return 0;
+            }
+
+            if (interval - _WAKE_GUARD_MILLIS_ - phase < sleep) {
+                sleep = interval - _WAKE_GUARD_MILLIS_ - phase;
+            }
+        }
+        return sleep;
+    }
+#endif // NRF_LINK_DONGLE
+
+// Update Sleep
+#ifdef NRF_LINK_DONGLE
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::update_sleep() {
+        // the radio needs its startup time to power up again,
+        // which the guard before each window leaves it
+        if (this->get_sleep_millis() == 0) {
+            this->wake();
+        } else if (!this->asleep) {
+            this->asleep = true;
+            this->sleep_timer = 0;
+            this->radio.powerDown();
+        }
+    }
+#endif // NRF_LINK_DONGLE
+
+// Wake
+#ifdef NRF_LINK_DONGLE
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::wake() {
+        if (!this->asleep) {
+            return;
+        }
+
+        this->asleep = false;
+        NRF_STATS_ADD(sleep_millis, (uint32_t)this->sleep_timer);
+        this->radio.powerUp();
+        this->radio.startListening();
+    }
+#endif // NRF_LINK_DONGLE
+
+// Accept Host
+#ifdef NRF_LINK_DONGLE
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> uint8_t NRFDongle<Backend, TData, max_packets, TReply, max_replies>::accept_host(const PairingPacket &pairing_packet) {
+        // returns the host slot given to the pairing host,
+        // or NRF_MAX_HOSTS if it was refused
+
+        // check if the program_id matches
+        if (pairing_packet.program_id != this->program_id) {
+            return NRF_MAX_HOSTS;
+        }
+
+        // check that the payload size holds at least one item
+        if (pairing_packet.payload_size < Packet<TData>::size(1) || pairing_packet.payload_size > 32) {
+            return NRF_MAX_HOSTS;
+        }
+
+        // a host pairing again keeps its slot, others take a free one
+        uint8_t slot = NRF_MAX_HOSTS;
+        for (uint8_t i = 0; i < NRF_MAX_HOSTS; i++) {
+            if (this->hosts[i].state != _HOST_FREE_ && this->hosts[i].unique_id == pairing_packet.unique_id) {
+                slot = i;
+                break;
+            }
+        }
+        for (uint8_t i = 0; i < NRF_MAX_HOSTS && slot == NRF_MAX_HOSTS; i++) {
+            if (this->hosts[i].state == _HOST_FREE_) {
+                slot = i;
+            }
+        }
+
+        // no room for another host
+        if (slot == NRF_MAX_HOSTS) {
+            return NRF_MAX_HOSTS;
+        }
+
+        if (this->has_hosts()) {
+            // hosts share the data rate, an adaptive host that moved it
+            // finds us back at the constructor's once the window ends
+            this->link_rate = this->data_rate;
+        } else {
+            // the first host sets the address and channel for all of them.
+            // the address is mixed from its whole unique_id and ours, as
+            // hosts with ids a few apart would otherwise give their dongles
+            // the same pipes, on what is often the same quietest channel.
+            // the channel is the one the host proposes,
+            // or the unique_id modulo 73 plus 1
+            this->address = (nrf_mix64(pairing_packet.unique_id ^ nrf_mix64(this->unique_id)) & 0xFFFFFFFF00ULL) | 0xC1;
+            if (pairing_packet.channel >= 1 && pairing_packet.channel <= _CHANNEL_COUNT_) {
+                this->channel = pairing_packet.channel;
+            } else {
+                this->channel = pairing_packet.unique_id % _CHANNEL_COUNT_ + 1;
+            }
+            this->radio.openReadingPipe(1, this->pipe_address(1));
+
+            // stay on the pairing channel until the host has its accept
+            this->pair_window = true;
+            this->window_timer = 0;
+        }
+
+        Host &host = this->hosts[slot];
+        if (host.state != _HOST_PENDING_) {
+            host.state = _HOST_PENDING_;
+            host.unique_id = pairing_packet.unique_id;
+            host.loaded_replies = 0;
+            host.buffer.clear();
+            host.buffer.reset_high_water_mark();
+            host.buffer.set_overflow_policy(this->overflow_policy);
+            host.reply_buffer.clear();
+            #ifdef NRF_PACKET_TIMESTAMP
+                host.sent.clear();
+                host.sent.set_overflow_policy(this->overflow_policy);
+            #endif // NRF_PACKET_TIMESTAMP
+            this->radio.openReadingPipe(slot + 1, this->pipe_address(slot + 1));
+            // another host may have been paired on this slot
+            this->paired = this->get_host_count() > 0;
+        }
+        host.ping_interval_millis = pairing_packet.ping_interval_millis;
+        host.grace_millis = pairing_packet.reconnect_grace_millis;
+        host.wake_interval_millis = pairing_packet.wake_interval_millis;
+        host.ping_timer = 0;
+        // the host may have restarted its numbers
+        host.sequenced = false;
+        host.missed_packets = 0;
+        host.assembling = false;
+        host.incomplete_items = 0;
+        host.referenced = false;
+        #ifdef NRF_PACKET_TIMESTAMP
+            // and its clock
+            host.clocked = false;
+            host.timed = false;
+            host.ping_delay_micros = 0;
+        #endif // NRF_PACKET_TIMESTAMP
+
+        // the largest packet any host sends
+        if (pairing_packet.payload_size > this->payload_size) {
+            this->payload_size = pairing_packet.payload_size;
+        }
+
+        // give the pairing hosts a little longer
+        if (this->pair_window) {
+            this->window_timer = 0;
+        }
+
+        return slot;
+    }
+#endif // NRF_LINK_DONGLE
+
+// Load Accept
+#ifdef NRF_LINK_DONGLE
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::load_accept(uint8_t first, uint8_t skip) {
+        // load the accept of the first pairing host from slot first on,
+        // wrapping around, (other than skip) on pipe 0,
+        // it goes out on the ACK of the next pairing packet.
+        // if that packet is from another host, it is ignored there
+        // and another is loaded, so hosts are accepted one at a time
+        if (this->loaded_accept < NRF_MAX_HOSTS) {
+            return;
+        }
+
+        for (uint8_t n = 0; n < NRF_MAX_HOSTS; n++) {
+            uint8_t i = (first + n) % NRF_MAX_HOSTS;
+            if (i == skip || this->hosts[i].state != _HOST_PENDING_) {
+                continue;
+            }
+
+            PairingAccept accept;
+            accept.unique_id = this->hosts[i].unique_id;
+            accept.address = this->pipe_address(i + 1);
+            accept.channel = this->channel;
+
+            uint8_t buf[PairingAccept::size];
+            accept.encode(buf);
+            if (this->radio.writeAckPayload(0, buf, PairingAccept::size)) {
+                this->loaded_accept = i;
+                NRF_STATS_ADD(frames_sent, 1);
+            }
+            return;
+        }
+    }
+#endif // NRF_LINK_DONGLE
+
+// Free Host
+#ifdef NRF_LINK_DONGLE
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::free_host(uint8_t host) {
+        // the buffers are kept until the slot is taken again,
+        // but read() and send() skip hosts that are not paired
+        if (this->hosts[host].state == _HOST_PAIRED_) {
+            NRF_STATS_ADD(unpairs, 1);
+        }
+        this->hosts[host].state = _HOST_FREE_;
+        this->hosts[host].unique_id = 0;
+        this->hosts[host].loaded_replies = 0;
+        this->radio.closeReadingPipe(host + 1);
+        this->paired = this->get_host_count() > 0;
+
+        // hosts pair at the constructor's data rate
+        if (!this->has_hosts() && this->link_rate != this->data_rate) {
+            this->link_rate = this->data_rate;
+            this->apply_data_rate(this->link_rate);
+        }
+    }
+#endif // NRF_LINK_DONGLE
+
+// Expire Hosts
+#ifdef NRF_LINK_DONGLE
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::expire_hosts() {
+        bool expired = false;
+
+        for (uint8_t i = 0; i < NRF_MAX_HOSTS; i++) {
+            Host &host = this->hosts[i];
+            if (host.state == _HOST_FREE_) {
+                continue;
+            }
+
+            // a host is gone after twice its ping interval without a packet,
+            // the wait for a wake window (see set_wake_interval()),
+            // and the time it keeps looking for us after that,
+            // a pairing host may also wait for the next pairing window
+            uint32_t timeout = 2 * (uint32_t)host.ping_interval_millis + host.wake_interval_millis + host.grace_millis;
+            if (host.state == _HOST_PENDING_) {
+                timeout += _PAIR_WINDOW_INTERVAL_MILLIS_;
+            }
+            if (host.ping_timer <= timeout) {
+                continue;
+            }
+
+            // the radio can only drop every loaded payload at once,
+            // so replies loaded for the other hosts are lost too,
+            // rather than sending this host's to the next host on its pipe
+            if (host.loaded_replies > 0) {
+                this->radio.flush_tx();
+                for (uint8_t j = 0; j < NRF_MAX_HOSTS; j++) {
+                    this->hosts[j].loaded_replies = 0;
+                }
+                this->loaded_accept = NRF_MAX_HOSTS;
+            }
+
+            this->free_host(i);
+            expired = true;
+        }
+
+        // the last host is gone, wait on the pairing channel
+        if (expired && !this->has_hosts()) {
+            this->end_pair_window();
+            this->pair_timer = 0;
+        }
+    }
+#endif // NRF_LINK_DONGLE
+
+// Update Pair Window
+#ifdef NRF_LINK_DONGLE
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::update_pair_window() {
+        if (this->pair_window) {
+            if (this->window_timer > _PAIR_WINDOW_MILLIS_) {
+                this->end_pair_window();
+            }
+        } else if (this->window_timer > _PAIR_WINDOW_INTERVAL_MILLIS_ && this->has_room()) {
+            // packets from paired hosts fail while we are away,
+            // their retries have to outlast the window
+            this->pair_window = true;
+            this->window_timer = 0;
+            this->radio.setChannel(_PAIR_CHANNEL_);
+            this->apply_data_rate(this->data_rate);
+        }
+    }
+#endif // NRF_LINK_DONGLE
+
+// End Pair Window
+#ifdef NRF_LINK_DONGLE
+    template <typename Backend, typename TData, uint8_t max_packets, typename TReply, uint8_t max_replies> void NRFDongle<Backend, TData, max_packets, TReply, max_replies>::end_pair_window() {
+        // back to the hosts, or stay on the pairing channel if there are none
+        this->pair_window = false;
+        this->window_timer = 0;
+        if (this->has_hosts()) {
+            this->radio.setChannel(this->channel);
+            this->apply_data_rate(this->link_rate);
+        } else {
+            this->channel = _PAIR_CHANNEL_;
+            this->address = _PAIR_ADDRESS_;
+            this->radio.setChannel(_PAIR_CHANNEL_);
+        }
+    }
+#endif // NRF_LINK_DONGLE
+
+#endif // NRF_LINK_BUILT
+#undef NRF_LINK_BUILT
@@ -0,0 +1,1218 @@
+#ifndef NRF_SIM_H
+#define NRF_SIM_H
+
+// ============ NOTE ============
+// Simulated radio backend for nrf_dongle.h
+// define NRF_SIM (instead of NRF24 or NRF52) to build
+// NRFDongle with g++ on Linux, no hardware required,
+// or next to them for links on the simulated radio (NRFSimBackend)
+// ==============================
+
+// every SimRadio in the process shares one simulated air
+// and one virtual clock, so a host and a dongle can run
+// side by side in a single process and be profiled.
+// time only moves when a radio spends air time or when
+// the program calls nrf_sim::clock().advance() / delay()
+
+// the air model follows the nRF24L01+ enhanced shockburst:
+//     each attempt costs the TX settling time plus the frame
+//     (preamble, 5 byte address, 9 bit control field, payload, 2 byte CRC)
+//     an acknowledged attempt costs the RX turnaround plus the ACK frame
+//     a lost attempt costs the auto retransmit delay (retry_delay + 1) * 250us
+//     retransmissions reuse the packet id, so a receiver that got the frame
+//     but whose ACK was lost drops the duplicate, like the real chip
+//     writeFast() queues into a 3 level TX FIFO that is sent while it is
+//     full or on txStandBy(), a frame hitting the retry limit stalls it
+//     startWrite() returns at once, the frame's outcome is decided then
+//     but only shows in whatHappened() once its air time has passed
+//     with dynamic payloads a frame is as long as the data written,
+//     and an ACK can carry a payload queued with writeAckPayload(),
+//     which is kept until an ACK carrying it reaches the sender
+// a radio can have an interrupt handler attached, which runs on its own
+// thread each time a frame lands in the RX FIFO (the IRQ pin, RX_DR only)
+// frames and ACKs are lost according to a Gilbert-Elliott model:
+//     a "good" state with loss probability loss / ack_loss
+//     and a "bad" (burst) state with loss probability burst_loss
+// on top of it, a band of channels can have interference (e.g. a Wi-Fi AP),
+// which takes frames and ACKs there with probability noisy_loss,
+// and shows up as a carrier to testRPD() just as often, once the radio
+// listened for long enough (RX settling plus the detector's own 40us)
+// with parallel set, the devices' loops (clock tasks) run as if on separate
+// boards: a task that starts late because another one kept the clock busy
+// runs on its own time, and frames that overlap on a channel collide
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// data rates, values match rf24_datarate_e
+enum sim_datarate_e {
+    SIM_1MBPS = 0,
+    SIM_2MBPS = 1,
+    SIM_250KBPS = 2
+};
+
+// power levels, values match rf24_pa_dbm_e
+enum sim_pa_dbm_e {
+    SIM_PA_MIN = 0,
+    SIM_PA_LOW = 1,
+    SIM_PA_HIGH = 2,
+    SIM_PA_MAX = 3
+};
+
+class SimRadio;
+
+namespace nrf_sim {
+
+    // timing and loss model shared by every simulated radio
+    struct Config {
+        // time to go from standby to TX or RX, in microseconds
+        uint16_t tx_settle_micros = 130;
+        uint16_t rx_settle_micros = 130;
+        // time the received power detector needs after RX settled,
+        // testRPD() only sees a carrier after listening for both
+        uint16_t rpd_delay_micros = 40;
+        // time powerUp() blocks for when the radio was powered down,
+        // RF24 waits 5ms for the crystal (RF24_POWERUP_DELAY)
+        uint16_t powerup_micros = 5000;
+        // SPI cost of uploading or downloading one byte, in microseconds
+        uint16_t spi_micros_per_byte = 1;
+        // loss probabilities in the good state
+        double loss = 0.0;
+        double ack_loss = 0.0;
+        // loss probability in the bad (burst) state,
+        // and the per-frame probabilities of entering / leaving it
+        double burst_loss = 0.0;
+        double burst_enter = 0.0;
+        double burst_exit = 1.0;
+        // interference on channels noisy_first to noisy_last
+        uint8_t noisy_first = 0;
+        uint8_t noisy_last = 0;
+        double noisy_loss = 0.0;
+        // seed for the deterministic random number generator
+        uint64_t seed = 0x9E3779B97F4A7C15ull;
+        // tasks see the time they were due in millis() / micros() and send
+        // on the air at that time, a task that overran starts its next run
+        // when it is done, and of two frames that overlap on a channel
+        // the later one (in the order the tasks ran) is lost.
+        // ACKs take no part, and the frame that got through stays delivered
+        bool parallel = false;
+    };
+
+    // virtual clock in microseconds
+    // periodic tasks run while the clock advances, which is how
+    // a second device's loop keeps running while a radio blocks
+    class Clock {
+        public:
+            typedef void (*Task)(void *context);
+
+            uint64_t now() const {
+                return this->now_micros;
+            }
+
+            // the time on the running task's own board, see Config::parallel,
+            // which is behind now() by as much as the task started late
+            uint64_t local() const {
+                return this->now_micros - this->late_micros;
+            }
+
+            // move the clock forward, running any tasks that fall due
+            void advance(uint64_t micros) {
+                uint64_t target = this->now_micros + micros;
+
+                // a task that spends time (e.g. a blocking write) only moves
+                // the clock, it does not run the other tasks recursively
+                if (this->running) {
+                    this->now_micros = target;
+                    return;
+                }
+
+                this->running = true;
+                while (true) {
+                    ScheduledTask *next = nullptr;
+                    for (size_t i = 0; i < this->tasks.size(); i++) {
+                        if (this->tasks[i].next_micros <= target && (next == nullptr || this->tasks[i].next_micros < next->next_micros)) {
+                            next = &this->tasks[i];
+                        }
+                    }
+                    if (next == nullptr) {
+                        break;
+                    }
+                    if (next->next_micros > this->now_micros) {
+                        this->now_micros = next->next_micros;
+                    }
+                    if (this->parallel) {
+                        this->late_micros = this->now_micros - next->next_micros;
+                    }
+                    next->next_micros += next->period_micros;
+                    Task task = next->task;
+                    void *context = next->context;
+                    task(context);
+                    // an overrun loop runs again once it is done on its board
+                    if (this->parallel) {
+                        uint64_t done = this->local();
+                        for (size_t i = 0; i < this->tasks.size(); i++) {
+                            if (this->tasks[i].task == task && this->tasks[i].context == context && this->tasks[i].next_micros < done) {
+                                this->tasks[i].next_micros = done;
+                            }
+                        }
+                        this->late_micros = 0;
+                    }
+                    // the task may have spent time past the target
+                    if (this->now_micros > target) {
+                        target = this->now_micros;
+                    }
+                }
+                this->now_micros = target;
+                this->running = false;
+            }
+
+            // run task every period_micros of virtual time
+            void add_task(uint32_t period_micros, Task task, void *context) {
+                ScheduledTask scheduled;
+                scheduled.period_micros = period_micros > 0 ? period_micros : 1;
+                scheduled.next_micros = this->now_micros + scheduled.period_micros;
+                scheduled.task = task;
+                scheduled.context = context;
+                this->tasks.push_back(scheduled);
+            }
+
+            void remove_task(Task task, void *context) {
+                for (size_t i = 0; i < this->tasks.size(); i++) {
+                    if (this->tasks[i].task == task && this->tasks[i].context == context) {
+                        this->tasks.erase(this->tasks.begin() + i);
+                        return;
+                    }
+                }
+            }
+
+            // drop all tasks and go back to time zero,
+            // with tasks on their own time if parallel, see Config::parallel
+            void reset(bool parallel = false) {
+                this->tasks.clear();
+                this->now_micros = 0;
+                this->late_micros = 0;
+                this->running = false;
+                this->parallel = parallel;
+            }
+
+        private:
+            struct ScheduledTask {
+                uint32_t period_micros;
+                uint64_t next_micros;
+                Task task;
+                void *context;
+            };
+
+            uint64_t now_micros = 0;
+            // how late the running task started, while parallel
+            uint64_t late_micros = 0;
+            bool running = false;
+            bool parallel = false;
+            std::vector<ScheduledTask> tasks;
+    };
+
+    // the shared medium: every powered radio, the loss model and its RNG
+    class Air {
+        public:
+            Config config;
+
+            void reset(const Config &config) {
+                this->config = config;
+                this->rng_state = config.seed ? config.seed : 1;
+                this->bad_state = false;
+                this->frames.clear();
+                this->collisions = 0;
+            }
+
+            void reset() {
+                this->reset(this->config);
+            }
+
+            // uniform double in [0, 1), xorshift64*
+            double uniform() {
+                this->rng_state ^= this->rng_state >> 12;
+                this->rng_state ^= this->rng_state << 25;
+                this->rng_state ^= this->rng_state >> 27;
+                uint64_t value = this->rng_state * 0x2545F4914F6CDD1Dull;
+                return (value >> 11) * (1.0 / 9007199254740992.0);
+            }
+
+            // true if the next frame is lost, advancing the burst state
+            bool lose_frame() {
+                bool lost = this->uniform() < (this->bad_state ? this->config.burst_loss : this->config.loss);
+                this->step_burst_state();
+                return lost;
+            }
+
+            // true if the next ACK is lost, advancing the burst state
+            bool lose_ack() {
+                bool lost = this->uniform() < (this->bad_state ? this->config.burst_loss : this->config.ack_loss);
+                this->step_burst_state();
+                return lost;
+            }
+
+            // true if interference takes the next frame or ACK on channel
+            bool interfered(uint8_t channel) {
+                if (this->config.noisy_loss <= 0.0 || channel < this->config.noisy_first || channel > this->config.noisy_last) {
+                    return false;
+                }
+                return this->uniform() < this->config.noisy_loss;
+            }
+
+            void attach(SimRadio *radio) {
+                this->radios.push_back(radio);
+            }
+
+            void detach(SimRadio *radio) {
+                for (size_t i = 0; i < this->radios.size(); i++) {
+                    if (this->radios[i] == radio) {
+                        this->radios.erase(this->radios.begin() + i);
+                        return;
+                    }
+                }
+            }
+
+            // true if a frame from sender on channel, on the air from start_micros
+            // to end_micros, overlaps another radio's frame, see Config::parallel
+            bool collides(const SimRadio *sender, uint8_t channel, uint64_t start_micros, uint64_t end_micros) {
+                if (!this->config.parallel) {
+                    return false;
+                }
+
+                // tasks can be up to a few loops apart, older frames are forgotten
+                bool collided = false;
+                size_t kept = 0;
+                for (size_t i = 0; i < this->frames.size(); i++) {
+                    const AirFrame &frame = this->frames[i];
+                    if (frame.end_micros + 100000 < start_micros) {
+                        continue;
+                    }
+                    if (frame.sender != sender && frame.channel == channel && frame.start_micros < end_micros && start_micros < frame.end_micros) {
+                        collided = true;
+                    }
+                    this->frames[kept++] = frame;
+                }
+                this->frames.resize(kept);
+
+                AirFrame frame = {sender, channel, start_micros, end_micros};
+                this->frames.push_back(frame);
+                if (collided) {
+                    this->collisions++;
+                }
+                return collided;
+            }
+
+            // frames lost to collisions since the last reset
+            uint64_t collisions = 0;
+
+            // first radio listening for address on channel at data_rate
+            // returns the pipe through pipe, or nullptr if nobody listens
+            SimRadio *find_receiver(const SimRadio *sender, uint8_t channel, uint8_t data_rate, uint64_t address, uint8_t *pipe);
+
+        private:
+            // a frame on the air, while parallel
+            struct AirFrame {
+                const SimRadio *sender;
+                uint8_t channel;
+                uint64_t start_micros;
+                uint64_t end_micros;
+            };
+
+            uint64_t rng_state = 1;
+            bool bad_state = false;
+            std::vector<SimRadio *> radios;
+            std::vector<AirFrame> frames;
+
+            void step_burst_state() {
+                if (this->bad_state) {
+                    if (this->uniform() < this->config.burst_exit) {
+                        this->bad_state = false;
+                    }
+                } else if (this->uniform() < this->config.burst_enter) {
+                    this->bad_state = true;
+                }
+            }
+    };
+
+    // process-wide clock and air, shared by every translation unit
+    inline Clock &clock() {
+        static Clock instance;
+        return instance;
+    }
+
+    inline Air &air() {
+        static Air instance;
+        return instance;
+    }
+
+    // reset the clock and the air with a new model, e.g. between benchmark runs
+    inline void reset(const Config &config) {
+        clock().reset(config.parallel);
+        air().reset(config);
+    }
+
+    // stands in for the frame crc when detecting retransmissions (FNV-1a)
+    inline uint32_t checksum(const uint8_t *data, uint8_t size) {
+        uint32_t hash = 2166136261u;
+        for (uint8_t i = 0; i < size; i++) {
+            hash = (hash ^ data[i]) * 16777619u;
+        }
+        return hash;
+    }
+
+    // a pin interrupt: fire() runs handler(context) on the interrupt's own
+    // thread and waits for it to return, as if it preempted whatever was running.
+    // only one thread runs at a time, so the simulation itself needs no locks,
+    // but the handler and the main context share memory across two threads.
+    // handlers run in zero virtual time
+    class Interrupt {
+        public:
+            typedef void (*Handler)(void *context);
+
+            ~Interrupt() {
+                this->detach();
+            }
+
+            void attach(Handler handler, void *context) {
+                this->detach();
+                this->handler = handler;
+                this->context = context;
+                this->pending = false;
+                this->stopping = false;
+                this->thread = std::thread(&Interrupt::run, this);
+            }
+
+            void detach() {
+                if (!this->thread.joinable()) {
+                    return;
+                }
+                {
+                    std::lock_guard<std::mutex> lock(this->mutex);
+                    this->stopping = true;
+                }
+                this->signal.notify_all();
+                this->thread.join();
+            }
+
+            void fire() {
+                if (!this->thread.joinable()) {
+                    return;
+                }
+                std::unique_lock<std::mutex> lock(this->mutex);
+                this->pending = true;
+                this->signal.notify_all();
+                this->signal.wait(lock, [this] { return !this->pending; });
+            }
+
+            // true while a handler runs
+            static bool &active() {
+                static bool value = false;
+                return value;
+            }
+
+        private:
+            Handler handler = nullptr;
+            void *context = nullptr;
+            bool pending = false;
+            bool stopping = false;
+            std::mutex mutex;
+            std::condition_variable signal;
+            std::thread thread;
+
+            void run() {
+                std::unique_lock<std::mutex> lock(this->mutex);
+                while (true) {
+                    this->signal.wait(lock, [this] { return this->pending || this->stopping; });
+                    if (!this->pending) {
+                        return;
+                    }
+                    lock.unlock();
+                    active() = true;
+                    this->handler(this->context);
+                    active() = false;
+                    lock.lock();
+                    this->pending = false;
+                    this->signal.notify_all();
+                }
+            }
+    };
+
+    // on-air time of a frame carrying payload_size bytes, in microseconds
+    inline uint32_t frame_micros(uint8_t payload_size, uint8_t data_rate) {
+        // preamble + address + crc bytes, plus the 9 bit packet control field
+        uint32_t bits = 8 * (1 + 5 + (uint32_t)payload_size + 2) + 9;
+        switch (data_rate) {
+            case SIM_2MBPS:
+                return (bits + 1) / 2;
+            case SIM_250KBPS:
+                return bits * 4;
+            default:
+                return bits;
+        }
+    }
+
+} // namespace nrf_sim
+
+// with a real radio (NRF24 or NRF52) its platform has the Arduino
+// functions and types below, and the links run on its clock while
+// the simulated radios only move the virtual one, which the program
+// then advances on its own (nrf_sim::clock().advance())
+#if !defined(NRF24) && !defined(NRF52)
+
+// Arduino timing functions on the virtual clock
+inline unsigned long micros() {
+    return (unsigned long)nrf_sim::clock().local();
+}
+
+inline unsigned long millis() {
+    return (unsigned long)(nrf_sim::clock().local() / 1000);
+}
+
+inline void delayMicroseconds(unsigned int us) {
+    nrf_sim::clock().advance(us);
+}
+
+inline void delay(unsigned long ms) {
+    nrf_sim::clock().advance((uint64_t)ms * 1000);
+}
+
+// only one thread runs at a time (see nrf_sim::Interrupt),
+// so masking interrupts has nothing to do
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+// stand-in for https://github.com/pfeerick/elapsedMillis
+class elapsedMillis {
+    private:
+        unsigned long ms;
+    public:
+        elapsedMillis(void) { this->ms = millis(); }
+        elapsedMillis(unsigned long val) { this->ms = millis() - val; }
+        elapsedMillis(const elapsedMillis &orig) { this->ms = orig.ms; }
+        operator unsigned long () const { return millis() - this->ms; }
+        elapsedMillis &operator = (const elapsedMillis &rhs) { this->ms = rhs.ms; return *this; }
+        elapsedMillis &operator = (unsigned long val) { this->ms = millis() - val; return *this; }
+        elapsedMillis &operator -= (unsigned long val) { this->ms += val; return *this; }
+        elapsedMillis &operator += (unsigned long val) { this->ms -= val; return *this; }
+};
+
+// stand-in for Arduino's Print, what NRFSerialSink writes to
+class Print {
+    public:
+        virtual ~Print() {}
+        virtual size_t write(uint8_t byte) = 0;
+        virtual size_t write(const uint8_t *buffer, size_t size) {
+            size_t written = 0;
+            while (written < size && this->write(buffer[written])) {
+                written++;
+            }
+            return written;
+        }
+};
+
+// stand-in for https://github.com/rlogiacco/CircularBuffer/
+// with the same semantics: push() appends and overwrites the oldest
+// element when full, pop() removes the newest, shift() the oldest
+template <typename T, size_t S> class CircularBuffer {
+    public:
+        bool push(T value) {
+            bool overwritten = this->count == S;
+            this->items[(this->head + this->count) % S] = value;
+            if (overwritten) {
+                this->head = (this->head + 1) % S;
+            } else {
+                this->count++;
+            }
+            return !overwritten;
+        }
+
+        bool unshift(T value) {
+            bool overwritten = this->count == S;
+            this->head = (this->head + S - 1) % S;
+            this->items[this->head] = value;
+            if (!overwritten) {
+                this->count++;
+            }
+            return !overwritten;
+        }
+
+        T pop() {
+            this->count--;
+            return this->items[(this->head + this->count) % S];
+        }
+
+        T shift() {
+            T value = this->items[this->head];
+            this->head = (this->head + 1) % S;
+            this->count--;
+            return value;
+        }
+
+        T first() const { return this->items[this->head]; }
+        T last() const { return this->items[(this->head + this->count + S - 1) % S]; }
+        T operator [] (size_t index) const { return this->items[(this->head + index) % S]; }
+        size_t size() const { return this->count; }
+        size_t available() const { return S - this->count; }
+        size_t capacity() const { return S; }
+        bool isEmpty() const { return this->count == 0; }
+        bool isFull() const { return this->count == S; }
+        void clear() { this->head = 0; this->count = 0; }
+
+    private:
+        T items[S];
+        size_t head = 0;
+        size_t count = 0;
+};
+
+#endif // !NRF24 && !NRF52
+
+// simulated radio, implements the part of the RF24 / nrf_to_nrf
+// api that NRFDongle uses
+class SimRadio {
+    public:
+        SimRadio() {
+            nrf_sim::air().attach(this);
+        }
+
+        ~SimRadio() {
+            this->interrupt.detach();
+            nrf_sim::air().detach(this);
+        }
+
+        SimRadio(const SimRadio &) = delete;
+        SimRadio &operator = (const SimRadio &) = delete;
+
+        bool begin() {
+            this->powered = true;
+            this->listening = false;
+            this->channel = 76;
+            this->data_rate = SIM_1MBPS;
+            this->pa_level = SIM_PA_MAX;
+            this->retry_delay = 5;
+            this->retry_count = 15;
+            this->payload_size = 32;
+            this->tx_address = 0;
+            for (uint8_t i = 0; i < 6; i++) {
+                this->pipe_open[i] = false;
+                this->pipe_address[i] = 0;
+                this->last_sender[i] = nullptr;
+            }
+            this->rx_count = 0;
+            this->tx_count = 0;
+            this->ack_count = 0;
+            this->max_rt = false;
+            this->tx_pending = false;
+            this->tx_deciding = false;
+            this->dynamic_payloads = false;
+            this->ack_payloads = false;
+            this->arc = 0;
+            return true;
+        }
+
+        bool isChipConnected() { return true; }
+
+        void powerUp() {
+            if (!this->powered) {
+                this->spend(nrf_sim::air().config.powerup_micros);
+            }
+            this->powered = true;
+        }
+        void powerDown() { this->powered = false; }
+
+        void setChannel(uint8_t channel) { this->channel = channel > 125 ? 125 : channel; }
+        uint8_t getChannel() { return this->channel; }
+
+        bool setDataRate(uint8_t data_rate) {
+            if (data_rate > SIM_250KBPS) {
+                return false;
+            }
+            this->data_rate = data_rate;
+            return true;
+        }
+        uint8_t getDataRate() { return this->data_rate; }
+
+        void setPALevel(uint8_t level, bool lna_enable = true) {
+            (void)lna_enable;
+            this->pa_level = level > SIM_PA_MAX ? (uint8_t)SIM_PA_MAX : level;
+        }
+        uint8_t getPALevel() { return this->pa_level; }
+
+        void setRetries(uint8_t delay, uint8_t count) {
+            this->retry_delay = delay > 15 ? 15 : delay;
+            this->retry_count = count > 15 ? 15 : count;
+        }
+
+        void setPayloadSize(uint8_t size) { this->payload_size = size < 1 ? 1 : (size > 32 ? 32 : size); }
+        uint8_t getPayloadSize() { return this->payload_size; }
+
+        void enableDynamicPayloads() { this->dynamic_payloads = true; }
+        void disableDynamicPayloads() {
+            this->dynamic_payloads = false;
+            this->ack_payloads = false;
+        }
+
+        // ACK payloads require dynamic payloads, like on the real chip
+        void enableAckPayload() {
+            this->dynamic_payloads = true;
+            this->ack_payloads = true;
+        }
+        void disableAckPayload() { this->ack_payloads = false; }
+
+        // size of the frame at the head of the RX FIFO
+        uint8_t getDynamicPayloadSize() {
+            return this->rx_ready() ? this->rx_fifo[0].size : 0;
+        }
+
+        // queue a payload for the ACK of the next frame received on pipe
+        // returns false if the FIFO (3 levels) is full
+        bool writeAckPayload(uint8_t pipe, const void *buf, uint8_t len) {
+            if (!this->ack_payloads || this->ack_count == 3 || pipe > 5) {
+                return false;
+            }
+            RxFrame &frame = this->ack_fifo[this->ack_count++];
+            frame.size = len < 1 ? 1 : (len > 32 ? 32 : len);
+            frame.pipe = pipe;
+            memcpy(frame.data, buf, frame.size);
+            this->spend((uint32_t)nrf_sim::air().config.spi_micros_per_byte * frame.size);
+            return true;
+        }
+
+        bool isAckPayloadAvailable() {
+            return this->available();
+        }
+
+        // addresses are 5 bytes on air
+        void openWritingPipe(uint64_t address) {
+            this->tx_address = address & 0xFFFFFFFFFFull;
+            // like the real chip, pipe 0 receives the ACKs for the writing pipe
+            this->pipe_address[0] = this->tx_address;
+        }
+
+        void openReadingPipe(uint8_t pipe, uint64_t address) {
+            if (pipe > 5) {
+                return;
+            }
+            this->pipe_open[pipe] = true;
+            // like the real chip, pipes 2-5 only keep their low byte,
+            // the upper 4 bytes are those of pipe 1
+            if (pipe >= 2) {
+                this->pipe_address[pipe] = address & 0xFF;
+            } else {
+                this->pipe_address[pipe] = address & 0xFFFFFFFFFFull;
+            }
+            this->last_sender[pipe] = nullptr;
+        }
+
+        void closeReadingPipe(uint8_t pipe) {
+            if (pipe > 5) {
+                return;
+            }
+            this->pipe_open[pipe] = false;
+        }
+
+        // like the real radio, returns at once and settles in the background
+        void startListening() {
+            this->listening = true;
+            this->listen_start_micros = nrf_sim::clock().local();
+            this->listened_micros = 0;
+        }
+
+        void stopListening() {
+            if (this->listening) {
+                this->listened_micros = nrf_sim::clock().local() - this->listen_start_micros;
+            }
+            this->listening = false;
+        }
+
+        // received power detector, true if there was a carrier on the channel
+        // while listening, which only shows after the radio settled and the
+        // detector had its time, so a scan that waits too little sees none
+        bool testRPD() {
+            const nrf_sim::Config &config = nrf_sim::air().config;
+            uint64_t listened = this->listening ? nrf_sim::clock().local() - this->listen_start_micros : this->listened_micros;
+            if (listened < (uint64_t)config.rx_settle_micros + config.rpd_delay_micros) {
+                return false;
+            }
+            return nrf_sim::air().interfered(this->channel);
+        }
+        bool testCarrier() { return this->testRPD(); }
+
+        // blocking write, returns true if the frame was acknowledged
+        bool write(const void *buf, uint8_t len) {
+            this->finish_pending();
+            this->arc = 0;
+            if (!this->powered || this->listening) {
+                return false;
+            }
+
+            TxFrame frame;
+            this->load(frame, buf, len);
+            return this->transmit(frame);
+        }
+
+        // non-blocking write, the radio sends and retries the frame on its own,
+        // whatHappened() reports TX_DS or MAX_RT once it is done
+        void startWrite(const void *buf, uint8_t len, bool multicast) {
+            (void)multicast;
+            this->finish_pending();
+            this->arc = 0;
+
+            // nothing is sent, which shows as MAX_RT right away
+            this->tx_pending = true;
+            this->tx_done_micros = nrf_sim::clock().local();
+            this->tx_pending_ok = false;
+            if (!this->powered || this->listening) {
+                return;
+            }
+
+            TxFrame frame;
+            this->load(frame, buf, len);
+
+            // while parallel, each attempt is made once its air time has passed
+            // on our own time (see run_pending()), so it meets the receiver
+            // as it is then, the first one ends after the TX settling time
+            if (nrf_sim::air().config.parallel) {
+                this->tx_frame = frame;
+                this->tx_deciding = true;
+                this->tx_done_micros += nrf_sim::air().config.tx_settle_micros + nrf_sim::frame_micros(frame.size, this->data_rate);
+                return;
+            }
+
+            // run the retransmit loop now, but only note the air time it takes
+            this->deferring = true;
+            this->deferred_micros = 0;
+            this->tx_pending_ok = this->transmit(frame);
+            this->deferring = false;
+            this->tx_done_micros = nrf_sim::clock().local() + this->deferred_micros;
+        }
+
+        // read and clear the STATUS flags: the outcome of startWrite()
+        // once its frame is done, and whether the RX FIFO has data
+        void whatHappened(bool &tx_ok, bool &tx_fail, bool &rx_ready) {
+            // one SPI byte, at least a microsecond so polling moves the clock
+            uint16_t spi_micros = nrf_sim::air().config.spi_micros_per_byte;
+            this->spend(spi_micros > 0 ? spi_micros : 1);
+
+            tx_ok = false;
+            tx_fail = false;
+            this->run_pending();
+            rx_ready = this->rx_ready();
+            if (this->tx_pending && !this->tx_deciding && nrf_sim::clock().local() >= this->tx_done_micros) {
+                this->tx_pending = false;
+                tx_ok = this->tx_pending_ok;
+                tx_fail = !this->tx_pending_ok;
+            }
+        }
+
+        // queue a frame in the 3 level TX FIFO, blocking only while it is full
+        // returns false if a queued frame hit the retry limit (MAX_RT),
+        // which stalls the FIFO until txStandBy() or flush_tx()
+        bool writeFast(const void *buf, uint8_t len) {
+            this->finish_pending();
+            if (!this->powered || this->listening || this->max_rt) {
+                return false;
+            }
+
+            // the radio sends the queued frames while the FIFO is full
+            while (this->tx_count == 3) {
+                if (!this->transmit_head()) {
+                    return false;
+                }
+            }
+
+            this->load(this->tx_fifo[this->tx_count++], buf, len);
+            return true;
+        }
+
+        // wait until every queued frame is sent, then return to standby
+        // returns false, and flushes the FIFO, if a frame hit the retry limit
+        bool txStandBy() {
+            while (this->tx_count > 0 && !this->max_rt) {
+                this->transmit_head();
+            }
+            if (this->max_rt) {
+                this->max_rt = false;
+                this->flush_tx();
+                return false;
+            }
+            return true;
+        }
+
+        bool available() {
+            return this->available(nullptr);
+        }
+
+        bool available(uint8_t *pipe) {
+            if (!this->rx_ready()) {
+                return false;
+            }
+            if (pipe != nullptr) {
+                *pipe = this->rx_fifo[0].pipe;
+            }
+            return true;
+        }
+
+        void read(void *buf, uint8_t len) {
+            if (!this->rx_ready()) {
+                return;
+            }
+            RxFrame &frame = this->rx_fifo[0];
+            memcpy(buf, frame.data, len < frame.size ? len : frame.size);
+            this->spend((uint32_t)nrf_sim::air().config.spi_micros_per_byte * frame.size);
+            for (uint8_t i = 1; i < this->rx_count; i++) {
+                this->rx_fifo[i - 1] = this->rx_fifo[i];
+            }
+            this->rx_count--;
+        }
+
+        // retransmissions used by the last write
+        uint8_t getARC() { return this->arc; }
+
+        uint8_t flush_rx() {
+            this->rx_count = 0;
+            return 0;
+        }
+
+        uint8_t flush_tx() {
+            this->tx_count = 0;
+            this->ack_count = 0;
+            // a frame of startWrite() still being retried is not sent again
+            if (this->tx_deciding) {
+                this->tx_deciding = false;
+                this->tx_pending_ok = false;
+                this->tx_done_micros = nrf_sim::clock().local();
+            }
+            return 0;
+        }
+
+        // like attachInterrupt() on the IRQ pin, handler(context) runs
+        // (on another thread) each time a frame lands in the RX FIFO
+        void attachInterrupt(nrf_sim::Interrupt::Handler handler, void *context) {
+            this->interrupt.attach(handler, context);
+        }
+
+        void detachInterrupt() {
+            this->interrupt.detach();
+        }
+
+        // used by nrf_sim::Air to route frames
+        bool is_listening_on(uint8_t channel, uint8_t data_rate) const {
+            return this->powered && this->listening && this->channel == channel && this->data_rate == data_rate;
+        }
+
+        bool match_pipe(uint64_t address, uint8_t *pipe) const {
+            for (uint8_t i = 0; i < 6; i++) {
+                uint64_t pipe_address = this->pipe_address[i];
+                if (i >= 2) {
+                    pipe_address |= this->pipe_address[1] & 0xFFFFFFFF00ull;
+                }
+                if (this->pipe_open[i] && pipe_address == address) {
+                    *pipe = i;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    private:
+        struct RxFrame {
+            uint8_t data[32];
+            uint8_t size;
+            uint8_t pipe;
+            // when it is there on our own time, while parallel
+            uint64_t arrival_micros;
+        };
+
+        struct TxFrame {
+            uint8_t data[32];
+            uint8_t size;
+            uint8_t pid;
+        };
+
+        bool powered = false;
+        bool listening = false;
+        // when the radio last started listening, and for how long it did
+        uint64_t listen_start_micros = 0;
+        uint64_t listened_micros = 0;
+        uint8_t channel = 76;
+        uint8_t data_rate = SIM_1MBPS;
+        uint8_t pa_level = SIM_PA_MAX;
+        uint8_t retry_delay = 5;
+        uint8_t retry_count = 15;
+        uint8_t payload_size = 32;
+        uint8_t arc = 0;
+        uint8_t pid = 0;
+        uint64_t tx_address = 0;
+        bool pipe_open[6] = {false, false, false, false, false, false};
+        uint64_t pipe_address[6] = {0, 0, 0, 0, 0, 0};
+
+        // duplicate detection, per pipe: the sender, packet id and crc of the last frame
+        const SimRadio *last_sender[6] = {nullptr, nullptr, nullptr, nullptr, nullptr, nullptr};
+        uint8_t last_pid[6] = {0, 0, 0, 0, 0, 0};
+        uint32_t last_crc[6] = {0, 0, 0, 0, 0, 0};
+
+        // 3 level RX FIFO
+        RxFrame rx_fifo[3];
+        uint8_t rx_count = 0;
+
+        // 3 level TX FIFO for writeFast(), and its MAX_RT flag
+        TxFrame tx_fifo[3];
+        uint8_t tx_count = 0;
+        bool max_rt = false;
+
+        // the frame of startWrite() and when it is done, while deferring
+        // transmit() adds up its air time instead of spending it
+        bool tx_pending = false;
+        bool tx_pending_ok = false;
+        uint64_t tx_done_micros = 0;
+        // while parallel, the frame whose attempts are still being made
+        TxFrame tx_frame;
+        bool tx_deciding = false;
+        bool deferring = false;
+        uint32_t deferred_micros = 0;
+
+        // payloads waiting to ride on ACKs
+        bool dynamic_payloads = false;
+        bool ack_payloads = false;
+        RxFrame ack_fifo[3];
+        uint8_t ack_count = 0;
+
+        nrf_sim::Interrupt interrupt;
+
+        // a frame is waiting in the RX FIFO, a frame sent later
+        // on its sender's own time than ours is not there yet
+        bool rx_ready() const {
+            if (this->rx_count == 0) {
+                return false;
+            }
+            return !nrf_sim::air().config.parallel || this->rx_fifo[0].arrival_micros <= nrf_sim::clock().local();
+        }
+
+        void spend(uint32_t micros) {
+            if (this->deferring) {
+                this->deferred_micros += micros;
+                return;
+            }
+            // an interrupt handler must not run the other devices' loops
+            if (nrf_sim::Interrupt::active()) {
+                return;
+            }
+            nrf_sim::clock().advance(micros);
+        }
+
+        // a write waits for the frame of startWrite() to be done,
+        // and its flags are cleared like write() does on the real chip
+        void finish_pending() {
+            if (!this->tx_pending) {
+                return;
+            }
+            do {
+                uint64_t now = nrf_sim::clock().local();
+                if (now < this->tx_done_micros) {
+                    this->spend((uint32_t)(this->tx_done_micros - now));
+                }
+                this->run_pending();
+            } while (this->tx_deciding);
+            this->tx_pending = false;
+        }
+
+        // upload a frame over SPI, static payloads are always payload_size bytes long
+        void load(TxFrame &frame, const void *buf, uint8_t len) {
+            if (len > 32) {
+                len = 32;
+            }
+            memset(frame.data, 0, sizeof(frame.data));
+            frame.size = this->dynamic_payloads ? (len < 1 ? 1 : len) : this->payload_size;
+            memcpy(frame.data, buf, len < frame.size ? len : frame.size);
+            this->pid = (this->pid + 1) & 0x03;
+            frame.pid = this->pid;
+            this->spend((uint32_t)nrf_sim::air().config.spi_micros_per_byte * frame.size);
+        }
+
+        // send the frame at the head of the TX FIFO, setting MAX_RT on failure
+        bool transmit_head() {
+            if (!this->transmit(this->tx_fifo[0])) {
+                this->max_rt = true;
+                return false;
+            }
+            for (uint8_t i = 1; i < this->tx_count; i++) {
+                this->tx_fifo[i - 1] = this->tx_fifo[i];
+            }
+            this->tx_count--;
+            return true;
+        }
+
+        // run the auto retransmit loop for one frame
+        bool transmit(const TxFrame &frame) {
+            nrf_sim::Air &air = nrf_sim::air();
+            const nrf_sim::Config &config = air.config;
+
+            uint32_t frame_micros = nrf_sim::frame_micros(frame.size, this->data_rate);
+            uint32_t retry_micros = ((uint32_t)this->retry_delay + 1) * 250;
+
+            for (uint8_t attempt = 0; attempt <= this->retry_count; attempt++) {
+                this->arc = attempt;
+                this->spend(config.tx_settle_micros + frame_micros);
+
+                // the frame has just ended, on our own time
+                uint64_t sent_micros = nrf_sim::clock().local() + (this->deferring ? this->deferred_micros : 0);
+                if (this->try_frame(frame, sent_micros)) {
+                    return true;
+                }
+
+                // no ACK within the auto retransmit delay
+                this->spend(retry_micros);
+            }
+            return false;
+        }
+
+        // one attempt at a frame that ended at sent_micros, returns true
+        // if it was acknowledged, once the ACK's air time is spent
+        bool try_frame(const TxFrame &frame, uint64_t sent_micros) {
+            nrf_sim::Air &air = nrf_sim::air();
+            const nrf_sim::Config &config = air.config;
+
+            uint32_t frame_micros = nrf_sim::frame_micros(frame.size, this->data_rate);
+            bool collided = air.collides(this, this->channel, sent_micros - frame_micros, sent_micros);
+
+            uint8_t pipe = 0;
+            SimRadio *receiver = air.find_receiver(this, this->channel, this->data_rate, this->tx_address, &pipe);
+            if (receiver == nullptr || collided || air.lose_frame() || air.interfered(this->channel) || !receiver->receive(this, pipe, frame.data, frame.size, frame.pid, sent_micros)) {
+                return false;
+            }
+
+            RxFrame *ack_payload = receiver->ack_payload_for(pipe);
+            uint8_t ack_size = ack_payload != nullptr ? ack_payload->size : 0;
+            if (air.lose_ack() || air.interfered(this->channel)) {
+                return false;
+            }
+
+            this->spend(config.rx_settle_micros + nrf_sim::frame_micros(ack_size, this->data_rate));
+            // the payload is only dropped by the receiver once it has arrived,
+            // if our RX FIFO is full it stays queued for the next ACK
+            if (ack_payload != nullptr && this->rx_count < 3) {
+                RxFrame &received = this->rx_fifo[this->rx_count++];
+                received = *ack_payload;
+                received.pipe = 0;
+                received.arrival_micros = 0;
+                receiver->drop_ack_payload(ack_payload);
+            }
+            return true;
+        }
+
+        // while parallel, make the attempts at the frame of startWrite()
+        // that have ended on our own time, tx_done_micros is when the next
+        // one ends, or once decided, when the frame is done
+        void run_pending() {
+            const nrf_sim::Config &config = nrf_sim::air().config;
+            uint32_t frame_micros = nrf_sim::frame_micros(this->tx_frame.size, this->data_rate);
+            uint32_t retry_micros = ((uint32_t)this->retry_delay + 1) * 250;
+
+            while (this->tx_deciding && nrf_sim::clock().local() >= this->tx_done_micros) {
+                uint64_t sent_micros = this->tx_done_micros;
+
+                // the ACK's air time is only noted
+                this->deferring = true;
+                this->deferred_micros = 0;
+                bool acked = this->try_frame(this->tx_frame, sent_micros);
+                this->deferring = false;
+
+                if (acked) {
+                    this->tx_deciding = false;
+                    this->tx_pending_ok = true;
+                    this->tx_done_micros = sent_micros + this->deferred_micros;
+                } else if (this->arc == this->retry_count) {
+                    this->tx_deciding = false;
+                    this->tx_pending_ok = false;
+                    this->tx_done_micros = sent_micros + retry_micros;
+                } else {
+                    this->arc++;
+                    this->tx_done_micros = sent_micros + retry_micros + config.tx_settle_micros + frame_micros;
+                }
+            }
+        }
+
+        // called by the sender, returns true if the frame is acknowledged
+        // the frame can be read once our own time reaches arrival_micros
+        bool receive(const SimRadio *sender, uint8_t pipe, const uint8_t *data, uint8_t size, uint8_t pid, uint64_t arrival_micros) {
+            // both ends must agree on dynamic payloads, and static payloads
+            // must agree on the size, otherwise the CRC fails
+            if (sender->dynamic_payloads != this->dynamic_payloads || (!this->dynamic_payloads && size != this->payload_size)) {
+                return false;
+            }
+
+            // a retransmission of a frame we already have is acknowledged and dropped
+            uint32_t crc = nrf_sim::checksum(data, size);
+            if (this->last_sender[pipe] == sender && this->last_pid[pipe] == pid && this->last_crc[pipe] == crc) {
+                return true;
+            }
+
+            // a full RX FIFO does not acknowledge
+            if (this->rx_count == 3) {
+                return false;
+            }
+
+            // frames are kept in the order they arrive, while parallel
+            // a sender that ran first can have sent after a later one,
+            // otherwise they are there at once, in the order they were sent
+            if (!nrf_sim::air().config.parallel) {
+                arrival_micros = 0;
+            }
+            uint8_t slot = this->rx_count;
+            while (slot > 0 && this->rx_fifo[slot - 1].arrival_micros > arrival_micros) {
+                this->rx_fifo[slot] = this->rx_fifo[slot - 1];
+                slot--;
+            }
+            this->rx_count++;
+
+            RxFrame &frame = this->rx_fifo[slot];
+            memcpy(frame.data, data, size);
+            frame.size = size;
+            frame.pipe = pipe;
+            frame.arrival_micros = arrival_micros;
+            this->last_sender[pipe] = sender;
+            this->last_pid[pipe] = pid;
+            this->last_crc[pipe] = crc;
+
+            // RX_DR pulls the IRQ pin low
+            this->interrupt.fire();
+            return true;
+        }
+
+        // first queued ACK payload for pipe, or nullptr
+        RxFrame *ack_payload_for(uint8_t pipe) {
+            if (!this->ack_payloads) {
+                return nullptr;
+            }
+            for (uint8_t i = 0; i < this->ack_count; i++) {
+                if (this->ack_fifo[i].pipe == pipe) {
+                    return &this->ack_fifo[i];
+                }
+            }
+            return nullptr;
+        }
+
+        void drop_ack_payload(RxFrame *payload) {
+            for (uint8_t i = (uint8_t)(payload - this->ack_fifo) + 1; i < this->ack_count; i++) {
+                this->ack_fifo[i - 1] = this->ack_fifo[i];
+            }
+            this->ack_count--;
+        }
+};
+
+inline SimRadio *nrf_sim::Air::find_receiver(const SimRadio *sender, uint8_t channel, uint8_t data_rate, uint64_t address, uint8_t *pipe) {
+    for (size_t i = 0; i < this->radios.size(); i++) {
+        SimRadio *radio = this->radios[i];
+        if (radio != sender && radio->is_listening_on(channel, data_rate) && radio->match_pipe(address, pipe)) {
+            return radio;
+        }
+    }
+    return nullptr;
+}
+
+#endif // NRF_SIM_H